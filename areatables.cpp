@@ -0,0 +1,50 @@
+#include "areatables.h"
+
+void AreaTables::build(const RegionGrid& grid) {
+    int width = grid.getWidth();
+    int height = grid.getHeight();
+    stride = width + 1;
+    table.assign(static_cast<std::size_t>(height + 1) * stride, Entry());
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* zones = grid.zones() + grid.index(0, y);
+        const uint8_t* pops = grid.populations() + grid.index(0, y);
+        const int* levels = grid.pollutionLevels() + grid.index(0, y);
+        const uint8_t* flags = grid.flags() + grid.index(0, y);
+        const Entry* above = &table[static_cast<std::size_t>(y) * stride];
+        Entry* row = &table[static_cast<std::size_t>(y + 1) * stride];
+
+        // Running sums along the row plus the finished row above
+        int64_t running[SUMS] = {};
+        for (int x = 0; x < width; ++x) {
+            ZoneType type = static_cast<ZoneType>(zones[x]);
+            running[RESIDENTIAL] += type == ZoneType::RESIDENTIAL ? pops[x] : 0;
+            running[INDUSTRIAL] += type == ZoneType::INDUSTRIAL ? pops[x] : 0;
+            running[COMMERCIAL] += type == ZoneType::COMMERCIAL ? pops[x] : 0;
+            running[POLLUTION] += levels[x];
+            running[INVADED] += (flags[x] & RegionGrid::ALIEN_INVADED) != 0;
+            for (int s = 0; s < SUMS; ++s) {
+                row[x + 1].sum[s] = above[x + 1].sum[s] + running[s];
+            }
+        }
+    }
+}
+
+AreaStats AreaTables::query(int x1, int y1, int x2, int y2) const {
+    const Entry& whole = at(x2 + 1, y2 + 1);
+    const Entry& left = at(x1, y2 + 1);
+    const Entry& top = at(x2 + 1, y1);
+    const Entry& corner = at(x1, y1);
+    int64_t total[SUMS];
+    for (int s = 0; s < SUMS; ++s) {
+        total[s] = whole.sum[s] - left.sum[s] - top.sum[s] + corner.sum[s];
+    }
+
+    AreaStats stats;
+    stats.residential = total[RESIDENTIAL];
+    stats.industrial = total[INDUSTRIAL];
+    stats.commercial = total[COMMERCIAL];
+    stats.pollution = total[POLLUTION];
+    stats.alienInvaded = total[INVADED];
+    return stats;
+}
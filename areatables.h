@@ -0,0 +1,42 @@
+#ifndef AREATABLES_H
+#define AREATABLES_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+
+// Totals over a rectangle of the region
+struct AreaStats {
+    long long residential = 0;
+    long long industrial = 0;
+    long long commercial = 0;
+    long long pollution = 0;
+    long long alienInvaded = 0;  // Cells
+};
+
+// Summed-area tables over a region: after build(), the totals of any
+// rectangle are four lookups. Entry (x, y) holds the sums over all cells
+// above and left of it, with an extra zero row and column so rectangles on
+// the border need no special case. All five sums of an entry sit together,
+// so a query touches four short runs of memory.
+class AreaTables {
+public:
+    void build(const RegionGrid& grid);
+
+    // Inclusive rectangle; coordinates must be valid with x1 <= x2, y1 <= y2
+    AreaStats query(int x1, int y1, int x2, int y2) const;
+
+private:
+    enum Sum { RESIDENTIAL, INDUSTRIAL, COMMERCIAL, POLLUTION, INVADED, SUMS };
+
+    struct Entry {
+        int64_t sum[SUMS];
+    };
+
+    int stride = 0;  // Width + 1
+    std::vector<Entry> table;
+
+    const Entry& at(int x, int y) const { return table[static_cast<std::size_t>(y) * stride + x]; }
+};
+
+#endif
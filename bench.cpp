@@ -0,0 +1,263 @@
+// bench.cpp
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include "loader.h"
+#include "profiler.h"
+#include "regiongen.h"
+#include "simulation.h"
+
+// Benchmarks for the simulation phases on synthetic regions. Every benchmark
+// reports the bytes allocated per timed step (counted by the operator new
+// in profiler.cpp, so a kernel that starts allocating shows up), and those
+// that walk the region also report cells per second.
+//
+// Usage: bench [--max-size=N] [google benchmark flags]
+//        bench --generate SIZE PATH [SEED]   write a synthetic layout as CSV
+// Sizes run from 64x64 up to --max-size (default 4096, at most 16384).
+
+#ifndef SIMCITY_COUNT_ALLOCATIONS
+#error "build bench with -DSIMCITY_COUNT_ALLOCATIONS"
+#endif
+
+// Access to the phases CitySimulation keeps private
+class SimulationBenchmark {
+public:
+    static bool loadRegionLayout(CitySimulation& sim, const std::string& path) { return sim.loadRegionLayout(path); }
+    static void calculateResources(CitySimulation& sim) { sim.calculateResources(); }
+    static void recountResources(CitySimulation& sim, int& workers, int& goods) {
+        sim.recountResources(workers, goods);
+    }
+    static void updatePollution(CitySimulation& sim) { sim.updatePollution(); }
+    static void invalidatePollution(CitySimulation& sim) { sim.pollutionEngine.invalidate(); }
+    static void growCells(CitySimulation& sim) { sim.growCells(); }
+    static bool hasChanged(const CitySimulation& sim) { return sim.hasChanged(); }
+    static void printRegionState(CitySimulation& sim) { sim.printRegionState(); }
+};
+
+namespace {
+
+const int MIN_SIZE = 64;
+const int LARGEST_SIZE = 16384;
+int maxSize = 4096;
+
+// Layouts and their CSV files, generated once per size
+const RegionGrid& layout(int size) {
+    static std::map<int, std::unique_ptr<RegionGrid>> layouts;
+    std::unique_ptr<RegionGrid>& grid = layouts[size];
+    if (!grid) {
+        grid.reset(new RegionGrid());
+        RegionGenerator().generate(*grid, size, size);
+    }
+    return *grid;
+}
+
+const std::string& layoutFile(int size) {
+    static std::map<int, std::string> files;
+    std::string& path = files[size];
+    if (path.empty()) {
+        path = "bench_region_" + std::to_string(size) + ".csv";
+        RegionLoader::saveCsv(path, layout(size));
+    }
+    return path;
+}
+
+// A quiet simulation started from the layout of the given size
+void start(CitySimulation& sim, int size) {
+    sim.setQuiet(true);
+    sim.loadRegion(layout(size));
+}
+
+void reportBytes(benchmark::State& state, unsigned long long bytes) {
+    double steps = static_cast<double>(state.iterations());
+    state.counters["bytes/step"] = steps > 0 ? bytes / steps : 0;
+}
+
+void report(benchmark::State& state, long long cellsPerStep, unsigned long long bytes) {
+    double steps = static_cast<double>(state.iterations());
+    state.SetItemsProcessed(static_cast<int64_t>(steps * cellsPerStep));
+    state.counters["cells/s"] = benchmark::Counter(steps * cellsPerStep, benchmark::Counter::kIsRate);
+    reportBytes(state, bytes);
+}
+
+void sizes(benchmark::internal::Benchmark* benchmark) {
+    for (int size = MIN_SIZE; size <= maxSize; size *= 4) {
+        benchmark->Arg(size);
+    }
+    benchmark->Unit(benchmark::kMicrosecond);
+}
+
+void BM_LoadRegionLayout(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    const std::string& path = layoutFile(size);
+    CitySimulation sim;
+    sim.setQuiet(true);
+    unsigned long long before = Profiler::allocatedBytes();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SimulationBenchmark::loadRegionLayout(sim, path));
+    }
+    report(state, 1ll * size * size, Profiler::allocatedBytes() - before);
+}
+
+// Reads the totals the grid keeps current, so it costs the same at every
+// size and has no per-cell rate
+void BM_CalculateResources(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    CitySimulation sim;
+    start(sim, size);
+    unsigned long long before = Profiler::allocatedBytes();
+    for (auto _ : state) {
+        SimulationBenchmark::calculateResources(sim);
+    }
+    reportBytes(state, Profiler::allocatedBytes() - before);
+}
+
+// The full count those totals replace, as run by SIMCITY_CHECK_RESOURCES
+void BM_RecountResources(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    CitySimulation sim;
+    start(sim, size);
+    unsigned long long before = Profiler::allocatedBytes();
+    for (auto _ : state) {
+        int workers, goods;
+        SimulationBenchmark::recountResources(sim, workers, goods);
+        benchmark::DoNotOptimize(workers);
+        benchmark::DoNotOptimize(goods);
+    }
+    report(state, 1ll * size * size, Profiler::allocatedBytes() - before);
+}
+
+// A full pollution pass, as after a step that changed many sources
+void BM_UpdatePollution(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    CitySimulation sim;
+    start(sim, size);
+    SimulationBenchmark::updatePollution(sim);
+    unsigned long long before = Profiler::allocatedBytes();
+    for (auto _ : state) {
+        SimulationBenchmark::invalidatePollution(sim);
+        SimulationBenchmark::updatePollution(sim);
+    }
+    report(state, 1ll * size * size, Profiler::allocatedBytes() - before);
+}
+
+// Growth from the same starting state every iteration
+void BM_GrowCells(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    CitySimulation sim;
+    unsigned long long bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        start(sim, size);
+        SimulationBenchmark::calculateResources(sim);
+        SimulationBenchmark::updatePollution(sim);
+        unsigned long long before = Profiler::allocatedBytes();
+        state.ResumeTiming();
+
+        SimulationBenchmark::growCells(sim);
+
+        state.PauseTiming();
+        bytes += Profiler::allocatedBytes() - before;
+        state.ResumeTiming();
+    }
+    report(state, 1ll * size * size, bytes);
+}
+
+// Reads the change count of the last step; no per-cell rate
+void BM_HasChanged(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    CitySimulation sim;
+    start(sim, size);
+    unsigned long long before = Profiler::allocatedBytes();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SimulationBenchmark::hasChanged(sim));
+    }
+    reportBytes(state, Profiler::allocatedBytes() - before);
+}
+
+void BM_PrintRegionState(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    CitySimulation sim;
+    start(sim, size);
+    sim.setQuiet(false);
+    sim.setOutputFile("/dev/null");
+    unsigned long long before = Profiler::allocatedBytes();
+    for (auto _ : state) {
+        SimulationBenchmark::printRegionState(sim);
+    }
+    report(state, 1ll * size * size, Profiler::allocatedBytes() - before);
+}
+
+// Whole runs of STEPS steps; rates are per simulated step
+void BM_RunSimulation(benchmark::State& state) {
+    const int STEPS = 10;
+    int size = static_cast<int>(state.range(0));
+    CitySimulation sim;
+    unsigned long long bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        start(sim, size);
+        sim.setMaxTimeSteps(STEPS);
+        unsigned long long before = Profiler::allocatedBytes();
+        state.ResumeTiming();
+
+        sim.runSimulation();
+
+        state.PauseTiming();
+        bytes += Profiler::allocatedBytes() - before;
+        state.ResumeTiming();
+    }
+    state.counters["steps"] = STEPS;
+    report(state, 1ll * size * size * STEPS, bytes);
+    state.counters["bytes/step"] = state.counters["bytes/step"] / STEPS;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 4 && std::strcmp(argv[1], "--generate") == 0) {
+        int size = std::atoi(argv[2]);
+        uint64_t seed = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 1;
+        if (size <= 0) {
+            std::fprintf(stderr, "Invalid size %s\n", argv[2]);
+            return 1;
+        }
+        RegionGrid grid;
+        RegionGenerator(seed).generate(grid, size, size);
+        return RegionLoader::saveCsv(argv[3], grid) ? 0 : 1;
+    }
+
+    // Take --max-size out before Google Benchmark sees the arguments
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--max-size=", 11) == 0) {
+            maxSize = std::atoi(argv[i] + 11);
+            if (maxSize < MIN_SIZE || maxSize > LARGEST_SIZE) {
+                std::fprintf(stderr, "--max-size must be between %d and %d\n", MIN_SIZE, LARGEST_SIZE);
+                return 1;
+            }
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    BENCHMARK(BM_LoadRegionLayout)->Apply(sizes);
+    BENCHMARK(BM_CalculateResources)->Apply(sizes);
+    BENCHMARK(BM_RecountResources)->Apply(sizes);
+    BENCHMARK(BM_UpdatePollution)->Apply(sizes);
+    BENCHMARK(BM_GrowCells)->Apply(sizes);
+    BENCHMARK(BM_HasChanged)->Apply(sizes);
+    BENCHMARK(BM_PrintRegionState)->Apply(sizes);
+    BENCHMARK(BM_RunSimulation)->Apply(sizes);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+CheckpointWriter::CheckpointWriter() : stopping(false), queued(false), writing(false) {}
+
+CheckpointWriter::~CheckpointWriter() {
+    if (!worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void CheckpointWriter::submit(const std::string& path, const RegionGrid& grid, const RegionState& state) {
+    RegionFile::encode(grid, state, snapshot);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.swap(snapshot);
+        pendingPath = path;
+        queued = true;
+    }
+    if (!worker.joinable()) {
+        worker = std::thread(&CheckpointWriter::workerLoop, this);
+    }
+    wake.notify_one();
+}
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return !queued && !writing; });
+}
+
+void CheckpointWriter::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return queued || stopping; });
+        if (!queued) return;  // Stopping with nothing left to write
+
+        output.swap(pending);
+        std::string path = pendingPath;
+        queued = false;
+        writing = true;
+        lock.unlock();
+
+        if (!writeFile(path, output)) {
+            std::cerr << "Checkpoint to " << path << " failed" << std::endl;
+        }
+
+        lock.lock();
+        writing = false;
+        idle.notify_all();
+    }
+}
+
+bool CheckpointWriter::writeFile(const std::string& path, const std::vector<char>& bytes) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        file.flush();
+        if (!file) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
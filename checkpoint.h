@@ -0,0 +1,49 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "grid.h"
+#include "regionfile.h"
+
+// Writes .simregion checkpoints on a background thread. submit() encodes the
+// region into a snapshot buffer on the caller's thread (one copy of each
+// plane) and returns; the writer thread saves it to a temporary file and
+// renames it over the target, so an interrupted write never replaces the
+// last good checkpoint. If a snapshot is still queued when the next one is
+// submitted, the older one is dropped rather than stalling the caller.
+class CheckpointWriter {
+public:
+    CheckpointWriter();
+    ~CheckpointWriter();  // Finishes any queued write
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    void submit(const std::string& path, const RegionGrid& grid, const RegionState& state);
+
+    // Block until every submitted checkpoint has been written
+    void flush();
+
+private:
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping;
+    bool queued;
+    bool writing;
+
+    // Three buffers rotate so no write allocates once they have grown
+    std::vector<char> snapshot;  // Filled by submit, caller thread only
+    std::vector<char> pending;   // Queued for the writer
+    std::vector<char> output;    // Being written
+    std::string pendingPath;
+
+    void workerLoop();
+    static bool writeFile(const std::string& path, const std::vector<char>& bytes);
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "executor.h"
+#include <algorithm>
+
+ParallelExecutor::ParallelExecutor(int threads)
+    : threadCount(0), generation(0), stopping(false), jobFunction(nullptr), jobTask(nullptr),
+      jobRows(0), jobBands(0), nextBand(0), pendingWorkers(0) {
+    setThreadCount(threads);
+}
+
+ParallelExecutor::~ParallelExecutor() {
+    stopWorkers();
+}
+
+void ParallelExecutor::setThreadCount(int threads) {
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads == threadCount) return;
+
+    stopWorkers();
+    threadCount = threads;
+    startWorkers();
+}
+
+int ParallelExecutor::bandCount(int rows) const {
+    int bands = (rows + MIN_BAND_ROWS - 1) / MIN_BAND_ROWS;
+    return std::max(1, std::min(bands, threadCount));
+}
+
+void ParallelExecutor::bandRange(int count, int bands, int band, int& begin, int& end) {
+    // Spread the remainder over the first bands
+    int base = count / bands;
+    int extra = count % bands;
+    begin = band * base + std::min(band, extra);
+    end = begin + base + (band < extra ? 1 : 0);
+}
+
+void ParallelExecutor::run(int rows, Trampoline function, void* task) {
+    int bands = bandCount(rows);
+    if (bands == 1) {
+        function(task, 0, 0, rows);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobFunction = function;
+        jobTask = task;
+        jobRows = rows;
+        jobBands = bands;
+        nextBand.store(0);
+        pendingWorkers = static_cast<int>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    runBands();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pendingWorkers == 0; });
+}
+
+void ParallelExecutor::runBands() {
+    for (int band = nextBand.fetch_add(1); band < jobBands; band = nextBand.fetch_add(1)) {
+        int begin, end;
+        bandRange(jobRows, jobBands, band, begin, end);
+        jobFunction(jobTask, band, begin, end);
+    }
+}
+
+void ParallelExecutor::workerLoop(unsigned long seen) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        runBands();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pendingWorkers == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+void ParallelExecutor::startWorkers() {
+    // Workers added after earlier jobs must not take the last one for new
+    unsigned long current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+        current = generation;
+    }
+    for (int i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ParallelExecutor::workerLoop, this, current);
+    }
+}
+
+void ParallelExecutor::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
@@ -0,0 +1,71 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads that runs row-band tiled loops. A grid of
+// `rows` rows is split into contiguous bands; each band is handed to one
+// thread, which may read a halo of rows around its band but writes only its
+// own rows. The calling thread works on bands too, and forEachBand returns
+// once every band is done. Small grids run inline on the caller.
+class ParallelExecutor {
+public:
+    static const int MIN_BAND_ROWS = 32;
+
+    explicit ParallelExecutor(int threads = 0);  // 0 = hardware concurrency
+    ~ParallelExecutor();
+
+    ParallelExecutor(const ParallelExecutor&) = delete;
+    ParallelExecutor& operator=(const ParallelExecutor&) = delete;
+
+    void setThreadCount(int threads);
+    int getThreadCount() const { return threadCount; }
+
+    // Number of bands forEachBand(rows, ...) will use
+    int bandCount(int rows) const;
+
+    // Run task(band, beginRow, endRow) over every band of [0, rows)
+    template <typename Task>
+    void forEachBand(int rows, Task&& task) {
+        run(rows, &invoke<Task>, &task);
+    }
+
+    // Split [0, count) into the same bands as forEachBand(count, ...)
+    static void bandRange(int count, int bands, int band, int& begin, int& end);
+
+private:
+    typedef void (*Trampoline)(void* task, int band, int begin, int end);
+
+    template <typename Task>
+    static void invoke(void* task, int band, int begin, int end) {
+        (*static_cast<Task*>(task))(band, begin, end);
+    }
+
+    int threadCount;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned long generation;
+    bool stopping;
+
+    // The job currently being run
+    Trampoline jobFunction;
+    void* jobTask;
+    int jobRows;
+    int jobBands;
+    std::atomic<int> nextBand;
+    int pendingWorkers;
+
+    void run(int rows, Trampoline function, void* task);
+    void runBands();
+    void workerLoop(unsigned long seen);
+    void startWorkers();
+    void stopWorkers();
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "grid.h"
+#include <algorithm>
+
+RegionGrid::RegionGrid() : width(0), height(0), stride(0), zoneData(nullptr), changedCells(0) {
+    std::fill(std::begin(zoneTotals), std::end(zoneTotals), 0);
+}
+
+void RegionGrid::resize(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+
+    // Round each row (cells plus both halo columns) up to ROW_ALIGN
+    int rowCells = width + 2 * HALO;
+    stride = (rowCells + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+
+    std::size_t cells = static_cast<std::size_t>(height + 2 * HALO) * stride;
+    zonePlane = std::make_shared<std::vector<uint8_t>>(cells, static_cast<uint8_t>(ZoneType::EMPTY));
+    zoneData = zonePlane->data();
+    populationPlane.assign(cells, 0);
+    frontPopulation.assign(cells, 0);
+    pollutionPlane.assign(cells, 0);
+    flagPlane.assign(cells, 0);
+    neighborCounts.assign(cells, 0);
+
+    touchedCells.clear();
+    changedCells = 0;
+    std::fill(std::begin(zoneTotals), std::end(zoneTotals), 0);
+}
+
+void RegionGrid::truncateRows(int newHeight) {
+    if (newHeight >= height) return;
+    height = newHeight;
+
+    std::size_t cells = static_cast<std::size_t>(height + 2 * HALO) * stride;
+    detachZones();
+    zonePlane->resize(cells);
+    zoneData = zonePlane->data();
+    populationPlane.resize(cells);
+    frontPopulation.resize(cells);
+    pollutionPlane.resize(cells);
+    flagPlane.resize(cells);
+    neighborCounts.resize(cells);
+}
+
+void RegionGrid::clear() {
+    resize(0, 0);
+}
+
+bool RegionGrid::empty() const {
+    return width == 0 || height == 0;
+}
+
+void RegionGrid::rebuildDerivedState() {
+    frontPopulation = populationPlane;
+    touchedCells.clear();
+    changedCells = 0;
+    std::fill(std::begin(zoneTotals), std::end(zoneTotals), 0);
+    std::fill(neighborCounts.begin(), neighborCounts.end(), 0);
+
+    for (int y = 0; y < height; ++y) {
+        for (std::size_t i = index(0, y), end = index(width, y); i < end; ++i) {
+            uint8_t pop = populationPlane[i];
+            zoneTotals[zoneData[i]] += pop;
+            uint32_t levels = levelMask(pop);
+            if (levels == 0) continue;
+            std::size_t above = i - stride;
+            std::size_t below = i + stride;
+            neighborCounts[above - 1] += levels; neighborCounts[above] += levels; neighborCounts[above + 1] += levels;
+            neighborCounts[i - 1] += levels;                                      neighborCounts[i + 1] += levels;
+            neighborCounts[below - 1] += levels; neighborCounts[below] += levels; neighborCounts[below + 1] += levels;
+        }
+    }
+}
+
+void RegionGrid::detachZones() {
+    if (zonePlane.use_count() > 1) {
+        zonePlane = std::make_shared<std::vector<uint8_t>>(*zonePlane);
+        zoneData = zonePlane->data();
+    }
+}
+
+void RegionGrid::setFlag(int x, int y, Flag flag, bool on) {
+    uint8_t& bits = flagPlane[index(x, y)];
+    if (on) {
+        bits |= flag;
+    } else {
+        bits &= static_cast<uint8_t>(~flag);
+    }
+}
+
+int RegionGrid::swapBuffers() {
+    int changed = changedCells;
+    populationPlane.swap(frontPopulation);
+
+    // The new back plane is the old front; only touched cells can differ
+    for (std::size_t i : touchedCells) {
+        populationPlane[i] = frontPopulation[i];
+    }
+    touchedCells.clear();
+    changedCells = 0;
+    return changed;
+}
+
+int RegionGrid::scanNeighborsAtLeast(int x, int y, int minPop) const {
+    int total = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            if (dx == 0 && dy == 0) continue;
+            if (isValidCoordinate(x + dx, y + dy) && getPopulation(x + dx, y + dy) >= minPop) {
+                total++;
+            }
+        }
+    }
+    return total;
+}
+
+Cell RegionGrid::cellAt(int x, int y) const {
+    Cell cell(getType(x, y));
+    cell.setPopulation(getPopulation(x, y));
+    cell.setPowered(hasFlag(x, y, POWERED));
+    cell.setAlienInvaded(hasFlag(x, y, ALIEN_INVADED));
+    return cell;
+}
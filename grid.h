@@ -0,0 +1,197 @@
+#ifndef GRID_H
+#define GRID_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cell.h"
+
+// Contiguous structure-of-arrays storage for a region. Every plane is
+// row-major with a one-cell halo on all sides (EMPTY, population 0), and rows
+// are padded to a multiple of ROW_ALIGN bytes, so neighbor scans need no
+// bounds checks and rows start on aligned offsets.
+//
+// Population is double buffered: the front plane holds the state committed by
+// the last swapBuffers(), the back plane is the working copy every read and
+// write goes to. Writes keep a count of cells whose back value differs from
+// the front, so "did this step change anything" needs no plane comparison.
+//
+// Each cell also carries a histogram of its 8 neighbors' populations: nibble
+// k-1 of the cell's word counts neighbors with population >= k, for k up to
+// COUNTED_LEVELS. setPopulation keeps the neighbors' words current, so
+// "how many neighbors have at least k" is a single load.
+//
+// Running population totals per zone type are kept the same way, so summing
+// e.g. all residential population is O(1).
+//
+// The zone plane is shared copy-on-write: copying a grid shares it, and the
+// first zone write through either copy detaches that copy. Many simulations
+// of one layout therefore hold a single zone plane between them.
+class RegionGrid {
+public:
+    enum Flag : uint8_t {
+        POWERED = 1 << 0,
+        ALIEN_INVADED = 1 << 1
+    };
+
+    static const int HALO = 1;
+    static const int ROW_ALIGN = 16;
+    static const int COUNTED_LEVELS = 5;
+
+    RegionGrid();
+
+    void resize(int width, int height);
+
+    // Drop rows from the bottom, keeping the rest. Only valid while the
+    // dropped rows are still untouched (EMPTY, population 0), which makes
+    // the new last row's successor a clean halo row.
+    void truncateRows(int newHeight);
+    void clear();
+    bool empty() const;
+
+    // Recompute the committed plane, neighbor histograms and zone totals
+    // after the zone and population planes were filled in directly
+    void rebuildDerivedState();
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getStride() const { return stride; }
+    std::size_t size() const { return populationPlane.size(); }
+
+    bool isValidCoordinate(int x, int y) const {
+        return y >= 0 && y < height && x >= 0 && x < width;
+    }
+
+    // Offset of (x, y) into any plane; the halo lets x/y range over -HALO..
+    std::size_t index(int x, int y) const {
+        return static_cast<std::size_t>(y + HALO) * stride + (x + HALO);
+    }
+
+    ZoneType getType(int x, int y) const { return static_cast<ZoneType>(zoneData[index(x, y)]); }
+    void setType(int x, int y, ZoneType type);
+
+    int getPopulation(int x, int y) const { return populationPlane[index(x, y)]; }
+    void setPopulation(int x, int y, int pop);
+
+    int getPollution(int x, int y) const { return pollutionPlane[index(x, y)]; }
+    void setPollution(int x, int y, int value) { pollutionPlane[index(x, y)] = value; }
+
+    // Sum of population over every cell of the given type
+    long long getTotalPopulation(ZoneType type) const { return zoneTotals[static_cast<int>(type)]; }
+
+    // Number of in-bounds neighbors of (x, y) with population >= minPop
+    int countNeighborsAtLeast(int x, int y, int minPop) const;
+
+    bool hasFlag(int x, int y, Flag flag) const { return (flagPlane[index(x, y)] & flag) != 0; }
+    void setFlag(int x, int y, Flag flag, bool on);
+
+    // Number of cells whose population differs from the committed state
+    int getChangedCellCount() const { return changedCells; }
+
+    // Commit the working population as the new front plane. Only the cells
+    // touched since the last swap are copied to bring the back plane level
+    // again. Returns how many cells changed during the step.
+    int swapBuffers();
+
+    // Value snapshot of one cell, for callers that want the old Cell API
+    Cell cellAt(int x, int y) const;
+
+    // Raw plane access for the kernels
+    const uint8_t* zones() const { return zoneData; }
+    uint8_t* writableZones() {
+        detachZones();
+        return zoneData;
+    }
+    uint8_t* populations() { return populationPlane.data(); }
+    const uint8_t* populations() const { return populationPlane.data(); }
+    const uint8_t* committedPopulations() const { return frontPopulation.data(); }
+    int* pollutionLevels() { return pollutionPlane.data(); }
+    const int* pollutionLevels() const { return pollutionPlane.data(); }
+    uint8_t* flags() { return flagPlane.data(); }
+    const uint8_t* flags() const { return flagPlane.data(); }
+
+private:
+    int width;
+    int height;
+    int stride;
+
+    std::shared_ptr<std::vector<uint8_t>> zonePlane;  // Shared between copies
+    uint8_t* zoneData;                                 // zonePlane's cells
+    std::vector<uint8_t> populationPlane;   // Back (working) buffer
+    std::vector<uint8_t> frontPopulation;   // Committed at the last swap
+    std::vector<int> pollutionPlane;
+    std::vector<uint8_t> flagPlane;
+    std::vector<uint32_t> neighborCounts;  // Packed per-level neighbor histogram
+    long long zoneTotals[static_cast<int>(ZoneType::EMPTY) + 1];
+
+    std::vector<std::size_t> touchedCells;  // Written since the last swap
+    int changedCells;
+
+    // Histogram nibbles covering levels 1..pop
+    static uint32_t levelMask(int pop) {
+        int levels = pop < COUNTED_LEVELS ? pop : COUNTED_LEVELS;
+        return static_cast<uint32_t>((1ull << (4 * levels)) - 1) / 0xF;
+    }
+
+    int scanNeighborsAtLeast(int x, int y, int minPop) const;
+
+    // Give this grid its own zone plane if it shares one
+    void detachZones();
+};
+
+inline void RegionGrid::setPopulation(int x, int y, int pop) {
+    std::size_t i = index(x, y);
+    uint8_t value = static_cast<uint8_t>(pop);
+    uint8_t committed = frontPopulation[i];
+    uint8_t previous = populationPlane[i];
+    if (previous == value) return;
+
+    bool wasChanged = previous != committed;
+    bool isChanged = value != committed;
+    if (isChanged && !wasChanged) {
+        touchedCells.push_back(i);
+    }
+    changedCells += static_cast<int>(isChanged) - static_cast<int>(wasChanged);
+    populationPlane[i] = value;
+    zoneTotals[zoneData[i]] += static_cast<int>(value) - static_cast<int>(previous);
+
+    // Shift the neighbors' histograms by the levels crossed
+    uint32_t delta = levelMask(value) ^ levelMask(previous);
+    if (delta != 0) {
+        std::size_t above = i - stride;
+        std::size_t below = i + stride;
+        uint32_t* counts = neighborCounts.data();
+        if (value > previous) {
+            counts[above - 1] += delta; counts[above] += delta; counts[above + 1] += delta;
+            counts[i - 1] += delta;                             counts[i + 1] += delta;
+            counts[below - 1] += delta; counts[below] += delta; counts[below + 1] += delta;
+        } else {
+            counts[above - 1] -= delta; counts[above] -= delta; counts[above + 1] -= delta;
+            counts[i - 1] -= delta;                             counts[i + 1] -= delta;
+            counts[below - 1] -= delta; counts[below] -= delta; counts[below + 1] -= delta;
+        }
+    }
+}
+
+inline void RegionGrid::setType(int x, int y, ZoneType type) {
+    detachZones();
+    std::size_t i = index(x, y);
+    zoneTotals[zoneData[i]] -= populationPlane[i];
+    zoneData[i] = static_cast<uint8_t>(type);
+    zoneTotals[zoneData[i]] += populationPlane[i];
+}
+
+inline int RegionGrid::countNeighborsAtLeast(int x, int y, int minPop) const {
+    if (minPop <= 0) {
+        // Every in-bounds neighbor qualifies
+        int cols = (x > 0) + 1 + (x < width - 1);
+        int rows = (y > 0) + 1 + (y < height - 1);
+        return cols * rows - 1;
+    }
+    if (minPop > COUNTED_LEVELS) {
+        return scanNeighborsAtLeast(x, y, minPop);
+    }
+    return (neighborCounts[index(x, y)] >> (4 * (minPop - 1))) & 0xF;
+}
+
+#endif
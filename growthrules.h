@@ -0,0 +1,98 @@
+#ifndef GROWTHRULES_H
+#define GROWTHRULES_H
+#include "cell.h"
+
+// Growth rules as compile-time policies. Each zone's rules are a type with
+// constexpr members:
+//
+//   ZONE             the zone the rules apply to
+//   WORKERS, GOODS   resources one growth step consumes
+//   LEVELS           populations 0 .. LEVELS-1 can grow
+//   MIN_ADJACENT[p]  a cell at population p grows with at least this many
+//                    neighbors at population p or more
+//   POWER_STARTS     a cell at population 0 may grow next to power instead
+//
+// The growth kernels are templates over these types, so every zone gets
+// its own copy with the table folded into constants and the unused
+// resource and power checks removed.
+//
+// A rule set groups the three zones. STANDARD is the tuned default;
+// -DSIMCITY_RULES_MILESTONE builds with the stricter original milestone
+// thresholds instead.
+namespace GrowthRules {
+
+// Whether a cell at population pop grows with adjacent neighbors at
+// population pop or more
+template <class Rules>
+constexpr bool passes(int pop, int adjacent, bool powered) {
+    return pop < Rules::LEVELS &&
+           ((pop == 0 && Rules::POWER_STARTS && powered) || adjacent >= Rules::MIN_ADJACENT[pop]);
+}
+
+struct Standard {
+    struct Commercial {
+        static constexpr ZoneType ZONE = ZoneType::COMMERCIAL;
+        static constexpr int WORKERS = 1;
+        static constexpr int GOODS = 1;
+        static constexpr int LEVELS = 2;
+        static constexpr int MIN_ADJACENT[LEVELS] = {1, 1};  // Reduced requirements
+        static constexpr bool POWER_STARTS = true;
+    };
+
+    struct Industrial {
+        static constexpr ZoneType ZONE = ZoneType::INDUSTRIAL;
+        static constexpr int WORKERS = 1;  // Decreased workers requirement
+        static constexpr int GOODS = 0;
+        static constexpr int LEVELS = 2;
+        static constexpr int MIN_ADJACENT[LEVELS] = {1, 2};
+        static constexpr bool POWER_STARTS = true;
+    };
+
+    struct Residential {
+        static constexpr ZoneType ZONE = ZoneType::RESIDENTIAL;
+        static constexpr int WORKERS = 0;
+        static constexpr int GOODS = 0;
+        static constexpr int LEVELS = 4;
+        static constexpr int MIN_ADJACENT[LEVELS] = {1, 2, 3, 4};  // Reduced for faster growth
+        static constexpr bool POWER_STARTS = true;
+    };
+};
+
+struct Milestone {
+    struct Commercial {
+        static constexpr ZoneType ZONE = ZoneType::COMMERCIAL;
+        static constexpr int WORKERS = 1;
+        static constexpr int GOODS = 1;
+        static constexpr int LEVELS = 2;
+        static constexpr int MIN_ADJACENT[LEVELS] = {1, 2};
+        static constexpr bool POWER_STARTS = true;
+    };
+
+    struct Industrial {
+        static constexpr ZoneType ZONE = ZoneType::INDUSTRIAL;
+        static constexpr int WORKERS = 2;
+        static constexpr int GOODS = 0;
+        static constexpr int LEVELS = 3;
+        static constexpr int MIN_ADJACENT[LEVELS] = {1, 2, 4};
+        static constexpr bool POWER_STARTS = true;
+    };
+
+    struct Residential {
+        static constexpr ZoneType ZONE = ZoneType::RESIDENTIAL;
+        static constexpr int WORKERS = 0;
+        static constexpr int GOODS = 0;
+        static constexpr int LEVELS = 5;
+        static constexpr int MIN_ADJACENT[LEVELS] = {1, 2, 4, 6, 8};
+        static constexpr bool POWER_STARTS = true;
+    };
+};
+
+#ifdef SIMCITY_RULES_MILESTONE
+typedef Milestone Active;
+#else
+typedef Standard Active;
+#endif
+
+}
+
+#endif
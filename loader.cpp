@@ -0,0 +1,148 @@
+#include "loader.h"
+#include <cstring>
+#include <fstream>
+#include "mappedfile.h"
+
+namespace {
+
+// Zone type for every possible first character of a field
+struct ZoneTable {
+    uint8_t type[256];
+
+    constexpr ZoneTable() : type() {
+        for (int c = 0; c < 256; ++c) {
+            type[c] = static_cast<uint8_t>(ZoneType::EMPTY);
+        }
+        type[static_cast<unsigned char>('R')] = static_cast<uint8_t>(ZoneType::RESIDENTIAL);
+        type[static_cast<unsigned char>('I')] = static_cast<uint8_t>(ZoneType::INDUSTRIAL);
+        type[static_cast<unsigned char>('C')] = static_cast<uint8_t>(ZoneType::COMMERCIAL);
+        type[static_cast<unsigned char>('-')] = static_cast<uint8_t>(ZoneType::ROAD);
+        type[static_cast<unsigned char>('T')] = static_cast<uint8_t>(ZoneType::POWERLINE);
+        type[static_cast<unsigned char>('#')] = static_cast<uint8_t>(ZoneType::POWERLINE_OVER_ROAD);
+        type[static_cast<unsigned char>('P')] = static_cast<uint8_t>(ZoneType::POWER_PLANT);
+    }
+};
+
+constexpr ZoneTable ZONE_TABLE;
+
+// Parse the fields of one line. Up to `capacity` types are written to out;
+// the return value counts all non-empty fields. The start of field number
+// `capacity` (the first one that does not fit) is reported in overflow.
+int parseLine(const char* begin, const char* end, uint8_t* out, int capacity, const char*& overflow) {
+    int count = 0;
+    const char* field = begin;
+    while (field < end) {
+        if (*field == ',') {
+            ++field;  // Empty field
+            continue;
+        }
+        if (count < capacity) {
+            out[count] = ZONE_TABLE.type[static_cast<unsigned char>(*field)];
+        } else if (count == capacity) {
+            overflow = field;
+        }
+        count++;
+
+        // Single-character fields are the norm; only longer ones need a search
+        if (field + 1 < end && field[1] == ',') {
+            field += 2;
+            continue;
+        }
+        const char* comma = static_cast<const char*>(std::memchr(field + 1, ',', end - field - 1));
+        if (!comma) break;
+        field = comma + 1;
+    }
+    return count;
+}
+
+const char* lineEnd(const char* line, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(line, '\n', end - line));
+    return newline ? newline : end;
+}
+
+const char* nextLine(const char* line, const char* end) {
+    const char* eol = lineEnd(line, end);
+    return eol == end ? end : eol + 1;
+}
+
+}
+
+bool RegionLoader::fail(size_t line, size_t column, const std::string& message) {
+    error = "line " + std::to_string(line) + ", column " + std::to_string(column) + ": " + message;
+    return false;
+}
+
+bool RegionLoader::loadCsv(const std::string& path, RegionGrid& grid) {
+    error.clear();
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    const char* data = file.data();
+    const char* end = data + file.size();
+
+    // Every line could be a row; the grid is trimmed afterwards if some
+    // turn out to be empty
+    size_t lines = 0;
+    for (const char* p = data; p < end; p = nextLine(p, end)) {
+        lines++;
+    }
+
+    // The first line with any fields fixes the width
+    int width = 0;
+    const char* unused = nullptr;
+    for (const char* p = data; p < end && width == 0; p = nextLine(p, end)) {
+        width = parseLine(p, lineEnd(p, end), nullptr, 0, unused);
+    }
+    if (width == 0) {
+        error = "no cells";
+        return false;
+    }
+
+    grid.resize(width, static_cast<int>(lines));
+    uint8_t* zones = grid.writableZones();
+
+    int row = 0;
+    size_t lineNumber = 0;
+    for (const char* p = data; p < end; ) {
+        const char* eol = lineEnd(p, end);
+        lineNumber++;
+
+        const char* overflow = nullptr;
+        int cells = parseLine(p, eol, zones + grid.index(0, row), width, overflow);
+        if (cells > 0 && cells != width) {
+            grid.clear();
+            if (cells > width) {
+                return fail(lineNumber, overflow - p + 1, "expected " + std::to_string(width) +
+                            " cells, found " + std::to_string(cells));
+            }
+            return fail(lineNumber, eol - p + 1, "expected " + std::to_string(width) +
+                        " cells, found " + std::to_string(cells));
+        }
+        if (cells > 0) row++;
+        p = nextLine(p, end);
+    }
+
+    grid.truncateRows(row);
+    return true;
+}
+
+bool RegionLoader::saveCsv(const std::string& path, const RegionGrid& grid) {
+    static const char SYMBOLS[] = {'R', 'I', 'C', '-', 'T', '#', 'P', ' '};
+    static_assert(sizeof(SYMBOLS) == static_cast<int>(ZoneType::EMPTY) + 1, "one symbol per zone type");
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    std::string line;
+    for (int y = 0; y < grid.getHeight(); ++y) {
+        line.clear();
+        const uint8_t* row = grid.zones() + grid.index(0, y);
+        for (int x = 0; x < grid.getWidth(); ++x) {
+            if (x > 0) line += ',';
+            line += SYMBOLS[row[x]];
+        }
+        line += '\n';
+        file << line;
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,34 @@
+#ifndef LOADER_H
+#define LOADER_H
+#include <cstddef>
+#include <string>
+#include "grid.h"
+
+// Reads CSV region layouts straight into a RegionGrid. The file is
+// memory-mapped, line and field boundaries are found with memchr (which the
+// C library vectorizes), and each field's first character is mapped to a
+// zone type through a 256-entry table.
+//
+// Parsing follows the original getline/stringstream reader: empty fields are
+// skipped, a field's type comes from its first character and anything
+// unrecognized is EMPTY, and lines without fields are ignored. Every row
+// must have as many cells as the first one.
+class RegionLoader {
+public:
+    // Returns false on failure; getError() then says why, and is empty if
+    // the file could not be opened at all
+    bool loadCsv(const std::string& path, RegionGrid& grid);
+
+    // Write the zone layout of grid in the same format. Population and
+    // other state are not part of a layout.
+    static bool saveCsv(const std::string& path, const RegionGrid& grid);
+
+    const std::string& getError() const { return error; }
+
+private:
+    std::string error;
+
+    bool fail(std::size_t line, std::size_t column, const std::string& message);
+};
+
+#endif
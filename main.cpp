@@ -1,10 +1,281 @@
 // main.cpp
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include "scenario.h"
 #include "simulation.h"
 using namespace std;
 
-int main() {
+// Exit codes of a headless run
+enum ExitStatus {
+    STATUS_OK = 0,
+    STATUS_USAGE = 1,        // Bad command line
+    STATUS_LOAD_FAILED = 2,  // Configuration or region could not be loaded
+    STATUS_OUTPUT_FAILED = 3,
+    STATUS_QUERY_FAILED = 4
+};
+
+const char* const STATUS_NAMES[] = {"ok", "usage", "load_failed", "output_failed", "query_failed"};
+
+struct Options {
+    string configFile;
+    string regionFile;
+    int steps = -1;    // -1 = from the configuration
+    int refresh = -1;
+    string outputFile;
+    RegionWriter::Mode outputMode = RegionWriter::Mode::FULL;
+    int threads = -1;  // -1 = default, 0 = hardware concurrency
+    CitySimulation::GrowthMode growthMode = CitySimulation::GrowthMode::PARALLEL;
+    bool hasSeed = false;
+    uint64_t seed = 0;
+    string queryFile;
+    string historyFile;
+    string saveFile;
+    bool resume = false;
+    bool stopOnCycle = false;
+    string scenarioFile;
+    string reportFile;
+    int jobs = 0;
+    string traceFile;
+};
+
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options]\n"
+         << "With no options the configuration file is read from the prompt.\n"
+         << "  --config FILE        configuration file (region, steps, refresh rate)\n"
+         << "  --region FILE        region layout (.csv) or saved region (.simregion)\n"
+         << "  --steps N            maximum time steps\n"
+         << "  --refresh N          print the region every N steps, 0 for never\n"
+         << "  --output FILE        write maps and reports to FILE instead of stdout\n"
+         << "  --output-mode MODE   full, rows (changed rows) or delta (changed cells)\n"
+         << "  --threads N          worker threads, 0 for one per core\n"
+         << "  --growth-mode MODE   serial, parallel (default) or verify (check one against the other)\n"
+         << "  --seed N             random seed (overrides the configuration's)\n"
+         << "  --queries FILE       answer the \"x1 y1 x2 y2\" rectangles in FILE\n"
+         << "  --record FILE        write the step history for the replay tool\n"
+         << "  --save FILE          save the final region (.simregion, or CSV otherwise)\n"
+         << "  --resume             continue from the checkpoint if one exists\n"
+         << "  --stop-on-cycle      end the run when the region returns to a recent state\n"
+         << "  --scenarios FILE     run every \"name seed [steps]\" line of FILE on the region\n"
+         << "  --report FILE        scenario results as CSV, or JSON if FILE ends in .json\n"
+         << "  --jobs N             scenarios run at once, 0 for one per core\n"
+         << "  --trace FILE         Chrome trace of every phase (builds with -DSIMCITY_PROFILE)\n"
+         << "A status line \"status=NAME exit=CODE steps=N\" is written to stderr.\n";
+}
+
+bool parseInt(const string& text, int minimum, int& value) {
+    char* end = nullptr;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || parsed < minimum || parsed > 1000000000L) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+bool parseArguments(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--resume") {
+            options.resume = true;
+            continue;
+        }
+        if (arg == "--stop-on-cycle") {
+            options.stopOnCycle = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h") return false;
+        static const char* const VALUE_OPTIONS[] = {"--config", "--region", "--steps", "--refresh", "--output",
+                                                    "--output-mode", "--threads", "--growth-mode", "--seed",
+                                                    "--queries", "--record", "--save", "--scenarios", "--report",
+                                                    "--jobs", "--trace"};
+        bool known = false;
+        for (const char* option : VALUE_OPTIONS) {
+            known = known || arg == option;
+        }
+        if (!known) {
+            cerr << "Unknown argument: " << arg << endl;
+            return false;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return false;
+        }
+
+        string value = argv[++i];
+        int number = 0;
+        if (arg == "--config") {
+            options.configFile = value;
+        } else if (arg == "--region") {
+            options.regionFile = value;
+        } else if (arg == "--output") {
+            options.outputFile = value;
+        } else if (arg == "--queries") {
+            options.queryFile = value;
+        } else if (arg == "--record") {
+            options.historyFile = value;
+        } else if (arg == "--save") {
+            options.saveFile = value;
+        } else if (arg == "--scenarios") {
+            options.scenarioFile = value;
+        } else if (arg == "--report") {
+            options.reportFile = value;
+        } else if (arg == "--trace") {
+            options.traceFile = value;
+        } else if (arg == "--output-mode") {
+            if (value == "full") {
+                options.outputMode = RegionWriter::Mode::FULL;
+            } else if (value == "rows") {
+                options.outputMode = RegionWriter::Mode::CHANGED_ROWS;
+            } else if (value == "delta") {
+                options.outputMode = RegionWriter::Mode::DELTA;
+            } else {
+                cerr << "Unknown output mode: " << value << endl;
+                return false;
+            }
+        } else if (arg == "--growth-mode") {
+            if (value == "serial") {
+                options.growthMode = CitySimulation::GrowthMode::SERIAL;
+            } else if (value == "parallel") {
+                options.growthMode = CitySimulation::GrowthMode::PARALLEL;
+            } else if (value == "verify") {
+                options.growthMode = CitySimulation::GrowthMode::VERIFY;
+            } else {
+                cerr << "Unknown growth mode: " << value << endl;
+                return false;
+            }
+        } else if (arg == "--seed") {
+            char* end = nullptr;
+            options.seed = strtoull(value.c_str(), &end, 10);
+            if (value.empty() || value[0] == '-' || *end != '\0') {
+                cerr << "Invalid value for --seed: " << value << endl;
+                return false;
+            }
+            options.hasSeed = true;
+        } else if (arg == "--steps" || arg == "--refresh" || arg == "--threads" || arg == "--jobs") {
+            if (!parseInt(value, 0, number)) {
+                cerr << "Invalid value for " << arg << ": " << value << endl;
+                return false;
+            }
+            if (arg == "--steps") options.steps = number;
+            if (arg == "--refresh") options.refresh = number;
+            if (arg == "--threads") options.threads = number;
+            if (arg == "--jobs") options.jobs = number;
+        }
+    }
+
+    if (options.configFile.empty() && options.regionFile.empty()) {
+        cerr << "Either --config or --region is required" << endl;
+        return false;
+    }
+    if (options.configFile.empty() && options.steps < 0) {
+        cerr << "--steps is required without --config" << endl;
+        return false;
+    }
+    if (!options.scenarioFile.empty() && options.reportFile.empty()) {
+        cerr << "--scenarios needs --report" << endl;
+        return false;
+    }
+    return true;
+}
+
+ExitStatus runScenarios(const Options& options, int& scenarioCount) {
+    // The configuration only supplies the region and the default step count;
+    // one thread, since this simulation never runs
+    CitySimulation settings(1);
+    if (!options.configFile.empty() && !settings.readConfiguration(options.configFile)) {
+        cerr << "Cannot read configuration " << options.configFile << endl;
+        return STATUS_LOAD_FAILED;
+    }
+    string regionFile = options.regionFile.empty() ? settings.getRegionFile() : options.regionFile;
+    int steps = options.steps >= 0 ? options.steps : settings.getMaxTimeSteps();
+
+    ScenarioRunner runner;
+    if (!runner.loadLayout(regionFile) || !runner.readScenarios(options.scenarioFile, steps)) {
+        cerr << runner.getError() << endl;
+        return STATUS_LOAD_FAILED;
+    }
+    runner.run(options.jobs);
+    scenarioCount = static_cast<int>(runner.getResults().size());
+
+    if (!runner.writeReport(options.reportFile)) {
+        cerr << "Cannot write report " << options.reportFile << endl;
+        return STATUS_OUTPUT_FAILED;
+    }
+    return STATUS_OK;
+}
+
+ExitStatus runHeadless(const Options& options, CitySimulation& sim) {
+    if (!options.traceFile.empty() && !sim.setTraceFile(options.traceFile)) {
+        cerr << "--trace needs a build with -DSIMCITY_PROFILE" << endl;
+        return STATUS_USAGE;
+    }
+    if (!options.configFile.empty() && !sim.readConfiguration(options.configFile)) {
+        cerr << "Cannot read configuration " << options.configFile << endl;
+        return STATUS_LOAD_FAILED;
+    }
+    if (!options.regionFile.empty()) {
+        sim.setRegionFile(options.regionFile);
+        if (options.configFile.empty()) {
+            string base = options.regionFile.substr(0, options.regionFile.find_last_of('.'));
+            sim.setCheckpoint(0, base + ".checkpoint.simregion");
+        }
+    }
+    if (options.steps >= 0) sim.setMaxTimeSteps(options.steps);
+    if (options.refresh >= 0) sim.setRefreshRate(options.refresh);
+    sim.setGrowthMode(options.growthMode);
+    sim.setStopOnCycle(options.stopOnCycle);
+
+    // A resumed checkpoint restores its own random state over the seed
+    if (options.hasSeed) sim.setSeed(options.seed);
+    if (!sim.load(options.resume)) {
+        cerr << "Cannot load the region" << endl;
+        return STATUS_LOAD_FAILED;
+    }
+
+    sim.setOutputMode(options.outputMode);
+    if (!options.outputFile.empty() && !sim.setOutputFile(options.outputFile)) {
+        cerr << "Cannot open output file " << options.outputFile << endl;
+        return STATUS_OUTPUT_FAILED;
+    }
+    if (!options.historyFile.empty() && !sim.recordHistory(options.historyFile)) {
+        cerr << "Cannot open history file " << options.historyFile << endl;
+        return STATUS_OUTPUT_FAILED;
+    }
+
+    sim.runSimulation();
+    sim.printFinalStats();
+    if (!options.saveFile.empty() && !sim.saveRegion(options.saveFile)) {
+        cerr << "Cannot save the region to " << options.saveFile << endl;
+        return STATUS_OUTPUT_FAILED;
+    }
+    if (!options.queryFile.empty() && !sim.analyzeAreas(options.queryFile)) {
+        cerr << "Cannot read queries from " << options.queryFile << endl;
+        return STATUS_QUERY_FAILED;
+    }
+    return STATUS_OK;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        Options options;
+        if (!parseArguments(argc, argv, options)) {
+            printUsage(argv[0]);
+            cerr << "status=" << STATUS_NAMES[STATUS_USAGE] << " exit=" << STATUS_USAGE << " steps=0" << endl;
+            return STATUS_USAGE;
+        }
+
+        if (!options.scenarioFile.empty()) {
+            int scenarios = 0;
+            ExitStatus status = runScenarios(options, scenarios);
+            cerr << "status=" << STATUS_NAMES[status] << " exit=" << status << " scenarios=" << scenarios << endl;
+            return status;
+        }
+
+        CitySimulation sim(options.threads);
+        ExitStatus status = runHeadless(options, sim);
+        cerr << "status=" << STATUS_NAMES[status] << " exit=" << status << " steps=" << sim.getTimeStep() << endl;
+        return status;
+    }
+
     string configFile;
     cout << "Enter simulation configuration file: ";
     getline(cin, configFile);
@@ -0,0 +1,59 @@
+#include "mappedfile.h"
+#include <fstream>
+#include <iterator>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SIMCITY_HAVE_MMAP 1
+#endif
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), mapped(false) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef SIMCITY_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(view);
+            length = static_cast<size_t>(info.st_size);
+            mapped = true;
+            ::close(fd);
+            return true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    // Empty files cannot be mapped; anything else unmappable is read
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    bytes = buffer.data();
+    length = buffer.size();
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef SIMCITY_HAVE_MMAP
+    if (mapped) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+#endif
+    buffer.clear();
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+}
@@ -0,0 +1,31 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped
+// so no bytes are copied; elsewhere (or if mapping fails) it is read into a
+// private buffer. The view stays valid until the object is destroyed.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return bytes; }
+    std::size_t size() const { return length; }
+
+private:
+    const char* bytes;
+    std::size_t length;
+    bool mapped;
+    std::vector<char> buffer;  // Fallback storage when not mapped
+};
+
+#endif
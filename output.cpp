@@ -0,0 +1,130 @@
+#include "output.h"
+#include <cstring>
+
+namespace {
+
+// Map symbol of each zone type when its population is 0
+const char ZONE_SYMBOLS[] = {'R', 'I', 'C', '-', 'T', '#', 'P', ' '};
+
+}
+
+RegionWriter::RegionWriter()
+    : out(&std::cout), mode(Mode::FULL), enabled(true), buffer(CHUNK_SIZE), used(0), shownWidth(0), shownHeight(0) {}
+
+bool RegionWriter::open(const std::string& path) {
+    flush();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    out = &file;
+    return true;
+}
+
+void RegionWriter::drain() {
+    if (enabled) out->write(buffer.data(), static_cast<std::streamsize>(used));
+    used = 0;
+}
+
+void RegionWriter::flush() {
+    drain();
+    out->flush();
+}
+
+RegionWriter& RegionWriter::text(const char* value) {
+    while (*value) put(*value++);
+    return *this;
+}
+
+RegionWriter& RegionWriter::number(long long value) {
+    char digits[24];
+    int count = 0;
+    unsigned long long magnitude = value < 0 ? 0ull - static_cast<unsigned long long>(value) : value;
+    do {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) put('-');
+    while (count > 0) put(digits[--count]);
+    return *this;
+}
+
+void RegionWriter::putCell(uint8_t zone, uint8_t pop) {
+    if (pop == 0) {
+        put(ZONE_SYMBOLS[zone]);
+    } else if (pop < 10) {
+        put(static_cast<char>('0' + pop));
+    } else {
+        number(pop);
+    }
+}
+
+void RegionWriter::putRow(const uint8_t* zones, const uint8_t* pops, int width) {
+    for (int x = 0; x < width; ++x) {
+        if (x > 0) put(',');
+        putCell(zones[x], pops[x]);
+    }
+    put('\n');
+}
+
+void RegionWriter::remember(const RegionGrid& grid, int y) {
+    std::size_t cell = grid.index(0, y);
+    std::size_t row = static_cast<std::size_t>(y) * grid.getWidth();
+    std::memcpy(&shownZones[row], grid.zones() + cell, grid.getWidth());
+    std::memcpy(&shownPopulation[row], grid.populations() + cell, grid.getWidth());
+}
+
+void RegionWriter::writeRegion(const RegionGrid& grid) {
+    if (!enabled) return;
+    int width = grid.getWidth();
+    int height = grid.getHeight();
+    bool full = mode == Mode::FULL || width != shownWidth || height != shownHeight;
+    if (full && mode != Mode::FULL) {
+        shownZones.resize(static_cast<std::size_t>(width) * height);
+        shownPopulation.resize(shownZones.size());
+        shownWidth = width;
+        shownHeight = height;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* zones = grid.zones() + grid.index(0, y);
+        const uint8_t* pops = grid.populations() + grid.index(0, y);
+        if (full) {
+            putRow(zones, pops, width);
+            if (mode != Mode::FULL) remember(grid, y);
+            continue;
+        }
+
+        std::size_t row = static_cast<std::size_t>(y) * width;
+        if (std::memcmp(zones, &shownZones[row], width) == 0 &&
+            std::memcmp(pops, &shownPopulation[row], width) == 0) {
+            continue;
+        }
+        if (mode == Mode::CHANGED_ROWS) {
+            number(y).text(": ");
+            putRow(zones, pops, width);
+        } else {
+            for (int x = 0; x < width; ++x) {
+                if (zones[x] == shownZones[row + x] && pops[x] == shownPopulation[row + x]) continue;
+                number(x).put(',');
+                number(y).put(',');
+                putCell(zones[x], pops[x]);
+                put('\n');
+            }
+        }
+        remember(grid, y);
+    }
+    put('\n');
+    drain();
+}
+
+void RegionWriter::writePollution(const RegionGrid& grid) {
+    if (!enabled) return;
+    for (int y = 0; y < grid.getHeight(); ++y) {
+        const int* levels = grid.pollutionLevels() + grid.index(0, y);
+        for (int x = 0; x < grid.getWidth(); ++x) {
+            if (x > 0) put(',');
+            number(levels[x]);
+        }
+        put('\n');
+    }
+    drain();
+}
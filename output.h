@@ -0,0 +1,81 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+// Formats region maps and report lines into a reusable byte buffer and hands
+// it to the output stream in large chunks. Numbers are formatted by hand and
+// nothing is flushed per line; the buffer is written out when it fills and
+// at the end of every map, so text written to the same stream elsewhere
+// stays in order.
+//
+// Region maps can be written in full, as only the rows that changed since
+// the previous map (each prefixed with its row number), or as a delta
+// listing "x,y,value" for every changed cell. The first map is always full.
+class RegionWriter {
+public:
+    enum class Mode {
+        FULL,
+        CHANGED_ROWS,
+        DELTA
+    };
+
+    static const std::size_t CHUNK_SIZE = 1 << 16;
+
+    RegionWriter();
+    ~RegionWriter() { flush(); }
+
+    RegionWriter(const RegionWriter&) = delete;
+    RegionWriter& operator=(const RegionWriter&) = delete;
+
+    // Write to the given file instead of stdout; false if it cannot be opened
+    bool open(const std::string& path);
+    void setMode(Mode newMode) { mode = newMode; }
+
+    // While disabled everything written is dropped
+    void setEnabled(bool on) { enabled = on; }
+
+    // One map in the original format: a comma-separated row per line, a
+    // cell's population if nonzero and its zone symbol otherwise
+    void writeRegion(const RegionGrid& grid);
+
+    // The pollution level of every cell, one comma-separated row per line
+    void writePollution(const RegionGrid& grid);
+
+    RegionWriter& text(const char* value);
+    RegionWriter& number(long long value);
+    RegionWriter& newline() { put('\n'); return *this; }
+
+    // Hand everything buffered to the stream and flush it
+    void flush();
+
+private:
+    std::ofstream file;
+    std::ostream* out;
+    Mode mode;
+    bool enabled;
+    std::vector<char> buffer;
+    std::size_t used;
+
+    // The last map written, to find what changed
+    std::vector<uint8_t> shownZones;
+    std::vector<uint8_t> shownPopulation;
+    int shownWidth;
+    int shownHeight;
+
+    void put(char c) {
+        if (used == buffer.size()) drain();
+        buffer[used++] = c;
+    }
+    void putCell(uint8_t zone, uint8_t pop);
+    void putRow(const uint8_t* zones, const uint8_t* pops, int width);
+    void remember(const RegionGrid& grid, int y);
+    void drain();
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "pollution.h"
+#include <algorithm>
+#include <cstdlib>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// dst[i] += src[i]
+void addRow(int* dst, const int* src, int n) {
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), sum);
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] += src[i];
+    }
+}
+
+// dst[i] -= src[i]
+void subtractRow(int* dst, const int* src, int n) {
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        __m256i diff = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), diff);
+    }
+#endif
+    for (; i < n; ++i) {
+        dst[i] -= src[i];
+    }
+}
+
+// dst[i] = sum of src[i - radius .. i + radius]; src must be readable there
+void boxRow(int* dst, const int* src, int n, int radius) {
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int d = -radius; d <= radius; ++d) {
+            sum = _mm256_add_epi32(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + d)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), sum);
+    }
+#endif
+    for (; i < n; ++i) {
+        int sum = 0;
+        for (int d = -radius; d <= radius; ++d) {
+            sum += src[i + d];
+        }
+        dst[i] = sum;
+    }
+}
+
+}
+
+PollutionEngine::PollutionEngine()
+    : width(0), height(0), paddedWidth(0), tracking(false), recomputed(false) {}
+
+void PollutionEngine::prepare(int newWidth, int newHeight, int bands) {
+    windows.resize(static_cast<size_t>(bands) * newWidth);
+    bandHasSources.resize(bands);
+    if (newWidth == width && newHeight == height) return;
+
+    width = newWidth;
+    height = newHeight;
+    paddedWidth = width + 2 * RADIUS;
+    source.assign(static_cast<size_t>(height) * paddedWidth, 0);
+    syncedSource.clear();
+    horizontal.assign(static_cast<size_t>(height + 2 * RADIUS) * width, 0);
+}
+
+bool PollutionEngine::buildLevel(const RegionGrid& grid, int level, int begin, int end) {
+    // Below RADIUS a level is the indicator pop > level; the last level
+    // carries everything above RADIUS as a weight
+    const uint8_t* zones = grid.zones();
+    const uint8_t* pops = grid.populations();
+    const uint8_t industrial = static_cast<uint8_t>(ZoneType::INDUSTRIAL);
+    bool any = false;
+
+    for (int y = begin; y < end; ++y) {
+        size_t cell = grid.index(0, y);
+        int* row = &source[static_cast<size_t>(y) * paddedWidth + RADIUS];
+        for (int x = 0; x < width; ++x) {
+            int pop = zones[cell + x] == industrial ? pops[cell + x] : 0;
+            int value = level < RADIUS ? (pop > level) : std::max(0, pop - RADIUS);
+            row[x] = value;
+            any |= value != 0;
+        }
+    }
+    return any;
+}
+
+void PollutionEngine::boxHorizontal(int radius, int begin, int end) {
+    for (int y = begin; y < end; ++y) {
+        boxRow(&horizontal[static_cast<size_t>(y + RADIUS) * width],
+               &source[static_cast<size_t>(y) * paddedWidth + RADIUS], width, radius);
+    }
+}
+
+void PollutionEngine::boxVertical(RegionGrid& grid, int radius, int* window, int begin, int end) {
+    // Slide a (2 * radius + 1)-row window down the horizontal sums, starting
+    // from the halo rows above the band; the zero rows above and below the
+    // region stand in for its edge
+    std::fill(window, window + width, 0);
+    for (int row = begin + RADIUS - radius; row < begin + RADIUS + radius; ++row) {
+        addRow(window, &horizontal[static_cast<size_t>(row) * width], width);
+    }
+
+    int* levels = grid.pollutionLevels();
+    for (int y = begin; y < end; ++y) {
+        addRow(window, &horizontal[static_cast<size_t>(y + RADIUS + radius) * width], width);
+        addRow(levels + grid.index(0, y), window, width);
+        subtractRow(window, &horizontal[static_cast<size_t>(y + RADIUS - radius) * width], width);
+    }
+}
+
+void PollutionEngine::compute(RegionGrid& grid, ParallelExecutor& executor) {
+    int bands = executor.bandCount(grid.getHeight());
+    prepare(grid.getWidth(), grid.getHeight(), bands);
+    recomputed = tracking;
+
+    int* levels = grid.pollutionLevels();
+    syncedSource.resize(grid.size());
+    const uint8_t* zones = grid.zones();
+    const uint8_t* pops = grid.populations();
+    const uint8_t industrial = static_cast<uint8_t>(ZoneType::INDUSTRIAL);
+    executor.forEachBand(height, [&](int, int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            std::fill(levels + grid.index(0, y), levels + grid.index(width, y), 0);
+            for (size_t cell = grid.index(0, y); cell < grid.index(width, y); ++cell) {
+                syncedSource[cell] = zones[cell] == industrial ? pops[cell] : 0;
+            }
+        }
+    });
+    pendingCells.clear();
+
+    // Levels are nested: once one has no sources, no higher one does either
+    for (int level = 0; level <= RADIUS; ++level) {
+        executor.forEachBand(height, [&](int band, int begin, int end) {
+            bandHasSources[band] = buildLevel(grid, level, begin, end);
+        });
+        if (std::find(bandHasSources.begin(), bandHasSources.end(), 1) == bandHasSources.end()) break;
+
+        // The vertical pass reads other bands' rows, so it waits for every
+        // horizontal band to finish
+        executor.forEachBand(height, [&](int, int begin, int end) {
+            boxHorizontal(level, begin, end);
+        });
+        executor.forEachBand(height, [&](int band, int begin, int end) {
+            boxVertical(grid, level, &windows[static_cast<size_t>(band) * width], begin, end);
+        });
+    }
+}
+
+void PollutionEngine::sourceChanged(const RegionGrid& grid, int x, int y) {
+    pendingCells.push_back(grid.index(x, y));
+}
+
+void PollutionEngine::rediffuse(RegionGrid& grid, int x, int y, int oldPop, int newPop) {
+    int* levels = grid.pollutionLevels();
+    for (int dy = -RADIUS; dy <= RADIUS; ++dy) {
+        for (int dx = -RADIUS; dx <= RADIUS; ++dx) {
+            if (!grid.isValidCoordinate(x + dx, y + dy)) continue;
+            int distance = std::max(std::abs(dx), std::abs(dy));
+            levels[grid.index(x + dx, y + dy)] +=
+                std::max(0, newPop - distance) - std::max(0, oldPop - distance);
+        }
+    }
+}
+
+void PollutionEngine::invalidate() {
+    syncedSource.clear();
+    pendingCells.clear();
+}
+
+void PollutionEngine::setTracking(bool on) {
+    tracking = on;
+    clearChanges();
+}
+
+void PollutionEngine::clearChanges() {
+    recomputed = false;
+    rediffused.clear();
+}
+
+void PollutionEngine::update(RegionGrid& grid, ParallelExecutor& executor) {
+    // A changed source costs one (2 * RADIUS + 1)^2 window; past roughly one
+    // window per cell the full pass is cheaper
+    const size_t window = (2 * RADIUS + 1) * (2 * RADIUS + 1);
+    bool stale = width != grid.getWidth() || height != grid.getHeight() || syncedSource.size() != grid.size();
+    if (stale || pendingCells.size() * window > static_cast<size_t>(width) * height) {
+        compute(grid, executor);
+        return;
+    }
+
+    // A cell may be listed more than once; after the first visit its synced
+    // value matches and the rest are no-ops
+    const uint8_t* zones = grid.zones();
+    const uint8_t* pops = grid.populations();
+    const uint8_t industrial = static_cast<uint8_t>(ZoneType::INDUSTRIAL);
+    int stride = grid.getStride();
+    for (size_t cell : pendingCells) {
+        int current = zones[cell] == industrial ? pops[cell] : 0;
+        int synced = syncedSource[cell];
+        if (current == synced) continue;
+
+        int x = static_cast<int>(cell % stride) - RegionGrid::HALO;
+        int y = static_cast<int>(cell / stride) - RegionGrid::HALO;
+        rediffuse(grid, x, y, synced, current);
+        if (tracking) rediffused.emplace_back(x, y);
+        syncedSource[cell] = static_cast<uint8_t>(current);
+    }
+    pendingCells.clear();
+}
@@ -0,0 +1,77 @@
+#ifndef POLLUTION_H
+#define POLLUTION_H
+#include <utility>
+#include <vector>
+#include "executor.h"
+#include "grid.h"
+
+// Computes the pollution field spread by industrial cells. An industrial cell
+// with population p adds max(0, p - d) to every cell within Chebyshev
+// distance d <= RADIUS. That field is rewritten as a sum of box filters:
+//
+//    sum over r < RADIUS of  Box_r([pop > r])  +  Box_RADIUS(max(0, pop - RADIUS))
+//
+// Each box filter is separable, so a level costs two linear passes instead
+// of a (2 * RADIUS + 1)^2 scatter per source, and levels with no sources are
+// skipped. Working buffers are kept between calls.
+//
+// Every pass is a gather over row bands: a band reads up to RADIUS rows of
+// halo from its neighbors' horizontal sums but writes only its own rows, so
+// bands run in parallel without write races.
+//
+// Between full passes the engine can also be kept current incrementally:
+// callers report industrial cells whose population changed, and update()
+// re-diffuses just those cells' windows, falling back to a full pass when so
+// many changed that the scatter would cost more.
+class PollutionEngine {
+public:
+    static const int RADIUS = 3;
+
+    PollutionEngine();
+
+    // Recompute the whole pollution plane of grid
+    void compute(RegionGrid& grid, ParallelExecutor& executor);
+
+    // Record that the population of the industrial cell at (x, y) changed
+    void sourceChanged(const RegionGrid& grid, int x, int y);
+
+    // Bring the pollution plane up to date with the reported changes
+    void update(RegionGrid& grid, ParallelExecutor& executor);
+
+    // Forget the synced state, e.g. after the grid was replaced wholesale;
+    // the next update() recomputes from scratch
+    void invalidate();
+
+    // While tracking, the engine remembers what its updates rewrote, for
+    // callers that mirror the plane: the windows re-diffused around each
+    // source, or that a full pass replaced everything
+    void setTracking(bool on);
+    const std::vector<std::pair<int, int>>& rediffusedSources() const { return rediffused; }
+    bool recomputedAll() const { return recomputed; }
+    void clearChanges();
+
+private:
+    int width;
+    int height;
+    int paddedWidth;
+
+    std::vector<int> source;      // One level's sources, RADIUS zero columns each side
+    std::vector<int> horizontal;  // Row box sums, RADIUS zero rows top and bottom
+    std::vector<int> windows;     // Running column sums, one row per band
+    std::vector<char> bandHasSources;
+
+    std::vector<uint8_t> syncedSource;  // Industrial population as of the last update
+    std::vector<std::size_t> pendingCells;
+
+    bool tracking;
+    bool recomputed;
+    std::vector<std::pair<int, int>> rediffused;
+
+    void prepare(int newWidth, int newHeight, int bands);
+    bool buildLevel(const RegionGrid& grid, int level, int begin, int end);
+    void boxHorizontal(int radius, int begin, int end);
+    void boxVertical(RegionGrid& grid, int radius, int* window, int begin, int end);
+    void rediffuse(RegionGrid& grid, int x, int y, int oldPop, int newPop);
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "power.h"
+#include <utility>
+
+namespace {
+
+const int NEIGHBOR_COUNT = 8;
+
+// Offsets of the 8 neighbors of a cell in a plane with the given stride
+void neighborOffsets(int stride, int offsets[NEIGHBOR_COUNT]) {
+    int n = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            if (dx != 0 || dy != 0) offsets[n++] = dy * stride + dx;
+        }
+    }
+}
+
+}
+
+bool PowerNetwork::isConductor(ZoneType type) {
+    return type == ZoneType::POWERLINE || type == ZoneType::POWERLINE_OVER_ROAD ||
+           type == ZoneType::POWER_PLANT;
+}
+
+int PowerNetwork::find(int cell) {
+    // Path halving
+    while (parent[cell] != cell) {
+        parent[cell] = parent[parent[cell]];
+        cell = parent[cell];
+    }
+    return cell;
+}
+
+int PowerNetwork::unite(int a, int b) {
+    int rootA = find(a);
+    int rootB = find(b);
+    if (rootA == rootB) return rootA;
+    if (rootA > rootB) std::swap(rootA, rootB);
+    parent[rootB] = rootA;
+    plantCount[rootA] += plantCount[rootB];
+    return rootA;
+}
+
+bool PowerNetwork::isEnergized(int cell) {
+    return parent[cell] >= 0 && plantCount[find(cell)] > 0;
+}
+
+void PowerNetwork::build(RegionGrid& grid) {
+    stride = grid.getStride();
+    parent.assign(grid.size(), -1);
+    plantCount.assign(grid.size(), 0);
+
+    const uint8_t* zones = grid.zones();
+    for (int y = 0; y < grid.getHeight(); ++y) {
+        for (int cell = static_cast<int>(grid.index(0, y)); cell < static_cast<int>(grid.index(grid.getWidth(), y)); ++cell) {
+            ZoneType type = static_cast<ZoneType>(zones[cell]);
+            if (!isConductor(type)) continue;
+            parent[cell] = cell;
+            plantCount[cell] = type == ZoneType::POWER_PLANT;
+
+            // Join the neighbors already visited in scan order
+            const int previous[] = {-1, -stride - 1, -stride, -stride + 1};
+            for (int offset : previous) {
+                if (parent[cell + offset] >= 0) unite(cell, cell + offset);
+            }
+        }
+    }
+
+    uint8_t* flags = grid.flags();
+    for (int y = 0; y < grid.getHeight(); ++y) {
+        for (int cell = static_cast<int>(grid.index(0, y)); cell < static_cast<int>(grid.index(grid.getWidth(), y)); ++cell) {
+            bool powered = false;
+            for (int dy = -1; dy <= 1 && !powered; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    if (isEnergized(cell + dy * stride + dx)) {
+                        powered = true;
+                        break;
+                    }
+                }
+            }
+            if (powered) {
+                flags[cell] |= RegionGrid::POWERED;
+            } else {
+                flags[cell] &= static_cast<uint8_t>(~RegionGrid::POWERED);
+            }
+        }
+    }
+}
+
+void PowerNetwork::refreshAround(RegionGrid& grid, int cell) {
+    int cx = cell % stride - RegionGrid::HALO;
+    int cy = cell / stride - RegionGrid::HALO;
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            if (!grid.isValidCoordinate(cx + dx, cy + dy)) continue;
+            int target = cell + dy * stride + dx;
+            bool powered = false;
+            for (int ny = -1; ny <= 1 && !powered; ++ny) {
+                for (int nx = -1; nx <= 1; ++nx) {
+                    if (isEnergized(target + ny * stride + nx)) {
+                        powered = true;
+                        break;
+                    }
+                }
+            }
+            grid.setFlag(cx + dx, cy + dy, RegionGrid::POWERED, powered);
+        }
+    }
+}
+
+void PowerNetwork::collectComponent(int start) {
+    // Depth-first walk over conductors 8-connected to start; visited tiles
+    // are marked by temporarily pointing them at themselves negated
+    int offsets[NEIGHBOR_COUNT];
+    neighborOffsets(stride, offsets);
+
+    component.clear();
+    stack.clear();
+    stack.push_back(start);
+    parent[start] = -2 - start;
+    while (!stack.empty()) {
+        int cell = stack.back();
+        stack.pop_back();
+        component.push_back(cell);
+        for (int offset : offsets) {
+            int next = cell + offset;
+            if (parent[next] >= 0) {
+                parent[next] = -2 - next;
+                stack.push_back(next);
+            }
+        }
+    }
+}
+
+void PowerNetwork::refreshComponent(RegionGrid& grid, int start) {
+    // The walk overwrites the parents, so point every tile straight at the
+    // root afterwards
+    int root = find(start);
+    int plants = plantCount[root];
+    collectComponent(start);
+    for (int cell : component) {
+        parent[cell] = root;
+    }
+    plantCount[root] = plants;
+
+    for (int cell : component) {
+        refreshAround(grid, cell);
+    }
+}
+
+void PowerNetwork::tileChanged(RegionGrid& grid, int x, int y, ZoneType oldType) {
+    int cell = static_cast<int>(grid.index(x, y));
+    ZoneType newType = grid.getType(x, y);
+    bool wasConductor = isConductor(oldType);
+    bool nowConductor = isConductor(newType);
+    int plantDelta = (newType == ZoneType::POWER_PLANT) - (oldType == ZoneType::POWER_PLANT);
+
+    if (!wasConductor && !nowConductor) return;
+
+    if (wasConductor && nowConductor) {
+        // Same component, possibly a different plant count
+        if (plantDelta == 0) return;
+        int root = find(cell);
+        bool before = plantCount[root] > 0;
+        plantCount[root] += plantDelta;
+        if (before != (plantCount[root] > 0)) refreshComponent(grid, cell);
+        return;
+    }
+
+    int offsets[NEIGHBOR_COUNT];
+    neighborOffsets(stride, offsets);
+
+    if (nowConductor) {
+        // Union into the neighboring components; if any of them was dark
+        // and the merged one is energized, their zones need refreshing
+        parent[cell] = cell;
+        plantCount[cell] = newType == ZoneType::POWER_PLANT;
+        bool anyDark = false;
+        for (int offset : offsets) {
+            int next = cell + offset;
+            if (parent[next] < 0) continue;
+            if (find(next) != find(cell) && plantCount[find(next)] == 0) anyDark = true;
+            unite(cell, next);
+        }
+        if (anyDark && isEnergized(cell)) {
+            refreshComponent(grid, cell);
+        } else {
+            refreshAround(grid, cell);
+        }
+        return;
+    }
+
+    // Removal can split the component: walk the old component, drop the
+    // tile, and rebuild the pieces from scratch
+    bool wasEnergized = isEnergized(cell);
+    collectComponent(cell);
+    for (int tile : component) {
+        parent[tile] = tile;
+        plantCount[tile] = 0;
+    }
+    parent[cell] = -1;
+
+    const uint8_t* zones = grid.zones();
+    for (int tile : component) {
+        if (tile == cell) continue;
+        plantCount[find(tile)] += static_cast<ZoneType>(zones[tile]) == ZoneType::POWER_PLANT;
+        for (int offset : offsets) {
+            int next = tile + offset;
+            if (parent[next] >= 0 && next != cell) unite(tile, next);
+        }
+    }
+
+    if (wasEnergized) {
+        for (int tile : component) {
+            refreshAround(grid, tile);
+        }
+    } else {
+        refreshAround(grid, cell);
+    }
+}
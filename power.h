@@ -0,0 +1,42 @@
+#ifndef POWER_H
+#define POWER_H
+#include <cstddef>
+#include <vector>
+#include "grid.h"
+
+// Tracks which power infrastructure is actually connected to a plant.
+// POWERLINE, POWERLINE_OVER_ROAD and POWER_PLANT tiles ("conductors") are
+// grouped into 8-connected components with a union-find; a component is
+// energized when it contains at least one plant. A cell is POWERED when a
+// conductor of an energized component lies in its 3x3 neighborhood.
+//
+// After build(), tile changes are applied incrementally: adding a conductor
+// unions it into its neighbors' components, removing one relabels only the
+// component it belonged to, and POWERED flags are refreshed only around
+// components whose energized state changed.
+class PowerNetwork {
+public:
+    static bool isConductor(ZoneType type);
+
+    // Label every component and set the POWERED flag of every cell
+    void build(RegionGrid& grid);
+
+    // The tile at (x, y) changed from oldType to its current grid type
+    void tileChanged(RegionGrid& grid, int x, int y, ZoneType oldType);
+
+private:
+    std::vector<int> parent;      // Union-find parent per cell, -1 if not a conductor
+    std::vector<int> plantCount;  // Plants in the component, valid at roots
+    std::vector<int> stack;       // Traversal scratch
+    std::vector<int> component;   // Tiles of the component being relabeled
+    int stride = 0;
+
+    int find(int cell);
+    int unite(int a, int b);
+    bool isEnergized(int cell);
+    void collectComponent(int start);
+    void refreshAround(RegionGrid& grid, int cell);
+    void refreshComponent(RegionGrid& grid, int start);
+};
+
+#endif
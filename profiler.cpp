@@ -0,0 +1,190 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <ostream>
+
+#ifdef SIMCITY_COUNT_ALLOCATIONS
+#include <atomic>
+
+namespace {
+
+std::atomic<unsigned long long> allocationCount(0);
+
+}
+
+// Kept out of line: GCC otherwise pairs inlined copies with free() and
+// warns about a new/delete mismatch that is not there
+#if defined(__GNUC__)
+#define SIMCITY_NOINLINE __attribute__((noinline))
+#else
+#define SIMCITY_NOINLINE
+#endif
+
+SIMCITY_NOINLINE void* operator new(std::size_t size) {
+    allocationCount.fetch_add(size, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+SIMCITY_NOINLINE void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+SIMCITY_NOINLINE void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+unsigned long long Profiler::allocatedBytes() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+#else
+unsigned long long Profiler::allocatedBytes() {
+    return 0;
+}
+#endif
+
+const char* const Profiler::PHASE_NAMES[PHASE_COUNT] = {
+    "resources", "pollution", "collect", "order", "grow",
+    "invasion", "swap", "record", "output", "checkpoint"
+};
+
+const char* const Profiler::COUNTER_NAMES[COUNTER_COUNT] = {
+    "candidates", "rule_checks", "cells_grown", "neighbor_lookups", "bytes_allocated"
+};
+
+namespace {
+
+// Nearest-rank percentile of values, which it sorts
+long long percentile(std::vector<long long>& values, double fraction) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * values.size()));
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+}
+
+Profiler::Profiler() : origin(Clock::now()), current() {}
+
+long long Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+}
+
+void Profiler::charge(long long until) {
+    if (activePhase < PHASE_COUNT) {
+        current.nanoseconds[activePhase] += until - activeSince;
+    }
+    activeSince = until;
+}
+
+void Profiler::traceEvent(int phase, long long start, long long end) {
+    if (tracing && trace.size() < MAX_TRACE_EVENTS) {
+        trace.push_back({phase, start, end - start});
+    }
+}
+
+void Profiler::beginStep() {
+    stepStart = now();
+    charge(stepStart);
+    current = StepTotals();
+    stepAllocations = allocatedBytes();
+}
+
+void Profiler::endStep() {
+    long long end = now();
+    charge(end);
+    current.counters[BYTES_ALLOCATED] = static_cast<long long>(allocatedBytes() - stepAllocations);
+    steps.push_back(current);
+    traceEvent(PHASE_COUNT, stepStart, end);
+    if (tracing && traceCounters.size() < MAX_TRACE_EVENTS) {
+        traceCounters.emplace_back(end, current);
+    }
+}
+
+Profiler::Scope::Scope(Profiler& profiler, Phase phase) : profiler(profiler), phase(phase) {
+    start = profiler.now();
+    profiler.charge(start);
+    outer = static_cast<Phase>(profiler.activePhase);
+    profiler.activePhase = phase;
+}
+
+Profiler::Scope::~Scope() {
+    long long end = profiler.now();
+    profiler.charge(end);
+    profiler.activePhase = outer;
+    profiler.traceEvent(phase, start, end);
+}
+
+void Profiler::report(std::ostream& out) const {
+    char line[128];
+    std::vector<long long> values(steps.size());
+
+    std::snprintf(line, sizeof(line), "Profile of %zu steps, per step:\n%-18s %12s %12s %12s %12s\n",
+                  steps.size(), "phase", "p50 us", "p99 us", "max us", "total ms");
+    out << line;
+    for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+        long long total = 0;
+        for (std::size_t i = 0; i < steps.size(); ++i) {
+            values[i] = steps[i].nanoseconds[phase];
+            total += values[i];
+        }
+        long long p50 = percentile(values, 0.50);
+        long long p99 = percentile(values, 0.99);
+        long long max = values.empty() ? 0 : values.back();
+        std::snprintf(line, sizeof(line), "%-18s %12.1f %12.1f %12.1f %12.3f\n", PHASE_NAMES[phase],
+                      p50 / 1e3, p99 / 1e3, max / 1e3, total / 1e6);
+        out << line;
+    }
+
+    std::snprintf(line, sizeof(line), "%-18s %12s %12s %12s %12s\n", "counter", "p50", "p99", "max", "total");
+    out << line;
+    for (int counter = 0; counter < COUNTER_COUNT; ++counter) {
+        long long total = 0;
+        for (std::size_t i = 0; i < steps.size(); ++i) {
+            values[i] = steps[i].counters[counter];
+            total += values[i];
+        }
+        long long p50 = percentile(values, 0.50);
+        long long p99 = percentile(values, 0.99);
+        long long max = values.empty() ? 0 : values.back();
+        std::snprintf(line, sizeof(line), "%-18s %12lld %12lld %12lld %12lld\n", COUNTER_NAMES[counter],
+                      p50, p99, max, total);
+        out << line;
+    }
+}
+
+bool Profiler::writeTrace(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file) return false;
+
+    // Complete ("X") events nest by time, so inner phases show under the
+    // step and invasion spans; the counters become one ("C") track
+    char event[256];
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const TraceEvent& entry : trace) {
+        std::snprintf(event, sizeof(event),
+                      "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                      first ? "" : ",\n", entry.phase < PHASE_COUNT ? PHASE_NAMES[entry.phase] : "step",
+                      entry.phase < PHASE_COUNT ? "phase" : "step", entry.start / 1e3, entry.duration / 1e3);
+        file << event;
+        first = false;
+    }
+    for (const auto& [end, totals] : traceCounters) {
+        file << (first ? "" : ",\n");
+        std::snprintf(event, sizeof(event), "{\"name\":\"work\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"args\":{",
+                      end / 1e3);
+        file << event;
+        for (int counter = 0; counter < COUNTER_COUNT; ++counter) {
+            file << (counter ? "," : "") << '"' << COUNTER_NAMES[counter] << "\":" << totals.counters[counter];
+        }
+        file << "}}";
+        first = false;
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
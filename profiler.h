@@ -0,0 +1,138 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include <chrono>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Per-phase timing and work counters for runSimulation. The hooks in the
+// simulation are the SIMCITY_PROFILE_* macros at the bottom, which expand to
+// nothing unless the program is built with -DSIMCITY_PROFILE, so a normal
+// build carries no timing code at all.
+//
+// Time is charged to the innermost open scope only (self time), so the
+// phases of a step add up to the step. Every step's totals are kept, and
+// report() prints the p50, p99 and maximum per step of each phase and
+// counter. With tracing on, every scope is also kept as a Chrome trace
+// event for chrome://tracing or Perfetto.
+class Profiler {
+public:
+    enum Phase {
+        RESOURCES,
+        POLLUTION,
+        COLLECT,     // Finding growth candidates
+        ORDER,       // Sorting them into priority order
+        GROW,
+        INVASION,
+        SWAP,        // Committing the population buffers
+        RECORD,      // Step history
+        OUTPUT,
+        CHECKPOINT,
+        PHASE_COUNT
+    };
+
+    enum Counter {
+        CANDIDATES,        // Cells queued for growth
+        RULE_CHECKS,       // Growth rule evaluations
+        CELLS_GROWN,
+        NEIGHBOR_LOOKUPS,  // 3x3 neighborhood population counts
+        BYTES_ALLOCATED,   // Through operator new, all threads
+        COUNTER_COUNT
+    };
+
+    static const char* const PHASE_NAMES[PHASE_COUNT];
+    static const char* const COUNTER_NAMES[COUNTER_COUNT];
+
+    // Trace events beyond this many are dropped
+    static const std::size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    Profiler();
+
+    void setTracing(bool on) { tracing = on; }
+
+    // Bracket one time step; work outside a step is traced but not counted
+    void beginStep();
+    void endStep();
+
+    void add(Counter counter, long long amount) { current.counters[counter] += amount; }
+
+    // Per-step percentiles of every phase and counter
+    void report(std::ostream& out) const;
+    bool writeTrace(const std::string& filename) const;
+
+    // Bytes allocated so far by the whole process; only counted in
+    // SIMCITY_COUNT_ALLOCATIONS builds, 0 otherwise
+    static unsigned long long allocatedBytes();
+
+    // Times one phase from construction to destruction
+    class Scope {
+    public:
+        Scope(Profiler& profiler, Phase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Profiler& profiler;
+        Phase phase;
+        Phase outer;
+        long long start;
+    };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct StepTotals {
+        long long nanoseconds[PHASE_COUNT];
+        long long counters[COUNTER_COUNT];
+    };
+
+    struct TraceEvent {
+        int phase;  // PHASE_COUNT for a whole step
+        long long start;
+        long long duration;
+    };
+
+    Clock::time_point origin;
+    StepTotals current;
+    std::vector<StepTotals> steps;
+    unsigned long long stepAllocations = 0;
+    long long stepStart = 0;
+
+    // The scope time is currently charged to, and since when
+    int activePhase = PHASE_COUNT;
+    long long activeSince = 0;
+
+    bool tracing = false;
+    std::vector<TraceEvent> trace;
+    std::vector<std::pair<long long, StepTotals>> traceCounters;  // Step end time and totals
+
+    long long now() const;
+    void charge(long long until);
+    void traceEvent(int phase, long long start, long long end);
+};
+
+// profiler.cpp replaces the global operator new to count allocations when
+// SIMCITY_COUNT_ALLOCATIONS is defined; profiling builds always count
+#if defined(SIMCITY_PROFILE) && !defined(SIMCITY_COUNT_ALLOCATIONS)
+#define SIMCITY_COUNT_ALLOCATIONS
+#endif
+
+#ifdef SIMCITY_PROFILE
+#define SIMCITY_PROFILE_CONCAT2(a, b) a##b
+#define SIMCITY_PROFILE_CONCAT(a, b) SIMCITY_PROFILE_CONCAT2(a, b)
+#define SIMCITY_PROFILE_SCOPE(profiler, phase) \
+    Profiler::Scope SIMCITY_PROFILE_CONCAT(profileScope, __LINE__)((profiler), Profiler::phase)
+#define SIMCITY_PROFILE_COUNT(profiler, counter, amount) (profiler).add(Profiler::counter, (amount))
+#define SIMCITY_PROFILE_BEGIN_STEP(profiler) (profiler).beginStep()
+#define SIMCITY_PROFILE_END_STEP(profiler) (profiler).endStep()
+#else
+#define SIMCITY_PROFILE_SCOPE(profiler, phase) ((void)0)
+#define SIMCITY_PROFILE_COUNT(profiler, counter, amount) ((void)0)
+#define SIMCITY_PROFILE_BEGIN_STEP(profiler) ((void)0)
+#define SIMCITY_PROFILE_END_STEP(profiler) ((void)0)
+#endif
+
+#endif
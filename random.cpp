@@ -0,0 +1,14 @@
+#include "random.h"
+
+void Random::reseed(uint64_t value) {
+    // Nearby seeds give unrelated keys
+    seed = value;
+    key = mix(value + GOLDEN);
+    counter = 0;
+}
+
+Random Random::stream(uint64_t id) const {
+    // The derived generator gets a seed of its own, so its seed and
+    // counter restore it like any other
+    return Random(mix(seed ^ mix(id + GOLDEN)));
+}
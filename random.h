@@ -0,0 +1,50 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+#include <cstdint>
+
+// Per-instance counter-based random source. Value n of a stream is the
+// SplitMix64 finalizer applied to key + (n + 1) * GOLDEN, so the whole state
+// is the key and a counter: it can be saved and restored exactly, jumped
+// anywhere in O(1), and split into independent streams. A parallel phase
+// derives one stream per tile (or per cell) from a stable id, so its
+// results do not depend on how the work is divided between threads.
+class Random {
+public:
+    explicit Random(uint64_t seed = 1) { reseed(seed); }
+
+    // Key the generator from seed and restart at counter 0
+    void reseed(uint64_t seed);
+
+    // Independent generator for the given id, e.g. a time step and tile,
+    // seeded from this generator's seed and the id
+    Random stream(uint64_t id) const;
+
+    uint64_t next() {
+        counter++;
+        return mix(key + counter * GOLDEN);
+    }
+
+    // Uniform in [0, bound), bound > 0 (multiply-shift, bias below 2^-32)
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>(((next() >> 32) * bound) >> 32);
+    }
+
+    uint64_t getSeed() const { return seed; }
+    uint64_t getCounter() const { return counter; }
+    void setCounter(uint64_t value) { counter = value; }
+
+private:
+    static const uint64_t GOLDEN = 0x9E3779B97F4A7C15ull;
+
+    uint64_t seed;
+    uint64_t key;
+    uint64_t counter;
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+#endif
@@ -0,0 +1,286 @@
+#include "recorder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char MAGIC[8] = {'S', 'I', 'M', 'D', 'E', 'L', 'T', 'A'};
+const std::size_t HEADER_SIZE = 16;
+
+// Bits of a step entry's field byte
+enum Field : uint8_t {
+    ZONE = 1 << 0,
+    POPULATION = 1 << 1,
+    POLLUTION = 1 << 2,
+    FLAGS = 1 << 3
+};
+
+void putVarint(std::vector<char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Reads from [pos, end); every read fails once past the end
+struct Reader {
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos == end) break;
+            uint8_t byte = *pos++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    uint8_t byte() {
+        if (pos == end) {
+            ok = false;
+            return 0;
+        }
+        return *pos++;
+    }
+};
+
+}
+
+StepRecorder::StepRecorder()
+    : keyframeInterval(DEFAULT_KEYFRAME_INTERVAL), keyframePending(false), pollutionPending(false), width(0),
+      height(0) {}
+
+bool StepRecorder::open(const std::string& path, const RegionGrid& grid, const RegionState& state,
+                        int interval) {
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    char header[HEADER_SIZE] = {};
+    std::memcpy(header, MAGIC, sizeof(MAGIC));
+    uint32_t version = VERSION;
+    std::memcpy(header + sizeof(MAGIC), &version, sizeof(version));
+    file.write(header, sizeof(header));
+
+    keyframeInterval = interval > 0 ? interval : DEFAULT_KEYFRAME_INTERVAL;
+    width = grid.getWidth();
+    height = grid.getHeight();
+    dirty.assign(static_cast<std::size_t>(width) * height, 0);
+    dirtyCells.clear();
+    writeKeyframe(grid, state);
+    return static_cast<bool>(file);
+}
+
+void StepRecorder::close() {
+    if (file.is_open()) file.close();
+}
+
+void StepRecorder::remember(const RegionGrid& grid) {
+    std::size_t cells = static_cast<std::size_t>(width) * height;
+    recordedZones.resize(cells);
+    recordedPopulation.resize(cells);
+    recordedPollution.resize(cells);
+    recordedFlags.resize(cells);
+    for (int y = 0; y < height; ++y) {
+        std::size_t row = static_cast<std::size_t>(y) * width;
+        std::size_t cell = grid.index(0, y);
+        std::memcpy(&recordedZones[row], grid.zones() + cell, width);
+        std::memcpy(&recordedPopulation[row], grid.populations() + cell, width);
+        std::memcpy(&recordedPollution[row], grid.pollutionLevels() + cell, width * sizeof(int));
+        std::memcpy(&recordedFlags[row], grid.flags() + cell, width);
+    }
+}
+
+void StepRecorder::writeRecord(RecordKind kind, int step, const std::vector<char>& bytes) {
+    prefix.clear();
+    prefix.push_back(static_cast<char>(kind));
+    putVarint(prefix, static_cast<uint64_t>(step));
+    putVarint(prefix, bytes.size());
+    file.write(prefix.data(), static_cast<std::streamsize>(prefix.size()));
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+void StepRecorder::writeKeyframe(const RegionGrid& grid, const RegionState& state) {
+    RegionFile::encode(grid, state, payload);
+    writeRecord(RecordKind::KEYFRAME, state.timeStep, payload);
+    remember(grid);
+    for (std::size_t cell : dirtyCells) {
+        dirty[cell] = 0;
+    }
+    dirtyCells.clear();
+    keyframePending = false;
+    pollutionPending = false;
+}
+
+void StepRecorder::areaChanged(int x, int y, int radius) {
+    for (int cy = std::max(0, y - radius); cy <= std::min(height - 1, y + radius); ++cy) {
+        for (int cx = std::max(0, x - radius); cx <= std::min(width - 1, x + radius); ++cx) {
+            cellChanged(cx, cy);
+        }
+    }
+}
+
+void StepRecorder::endStep(const RegionGrid& grid, const RegionState& state) {
+    if (!isOpen()) return;
+    if (keyframePending || state.timeStep % keyframeInterval == 0) {
+        writeKeyframe(grid, state);
+        return;
+    }
+
+    // After a full pollution pass nothing says where levels moved; add the
+    // cells of any row that differs
+    for (int y = 0; pollutionPending && y < height; ++y) {
+        std::size_t row = static_cast<std::size_t>(y) * width;
+        const int* levels = grid.pollutionLevels() + grid.index(0, y);
+        if (std::memcmp(levels, &recordedPollution[row], width * sizeof(int)) == 0) continue;
+        for (int x = 0; x < width; ++x) {
+            if (levels[x] != recordedPollution[row + x] && !dirty[row + x]) {
+                dirty[row + x] = 1;
+                dirtyCells.push_back(row + x);
+            }
+        }
+    }
+    pollutionPending = false;
+    std::sort(dirtyCells.begin(), dirtyCells.end());
+
+    entries.clear();
+    uint64_t count = 0;
+    std::size_t next = 0;  // First cell after the previous entry
+    for (std::size_t cell : dirtyCells) {
+        dirty[cell] = 0;
+        std::size_t gridCell = grid.index(static_cast<int>(cell % width), static_cast<int>(cell / width));
+        uint8_t zone = grid.zones()[gridCell];
+        uint8_t pop = grid.populations()[gridCell];
+        int pollution = grid.pollutionLevels()[gridCell];
+        uint8_t flags = grid.flags()[gridCell];
+
+        uint8_t fields = 0;
+        if (zone != recordedZones[cell]) fields |= ZONE;
+        if (pop != recordedPopulation[cell]) fields |= POPULATION;
+        if (pollution != recordedPollution[cell]) fields |= POLLUTION;
+        if (flags != recordedFlags[cell]) fields |= FLAGS;
+        if (fields == 0) continue;  // Changed and changed back
+
+        putVarint(entries, cell - next);
+        entries.push_back(static_cast<char>(fields));
+        if (fields & ZONE) entries.push_back(static_cast<char>(zone));
+        if (fields & POPULATION) entries.push_back(static_cast<char>(pop));
+        if (fields & POLLUTION) putVarint(entries, zigzag(static_cast<int64_t>(pollution) - recordedPollution[cell]));
+        if (fields & FLAGS) entries.push_back(static_cast<char>(flags));
+
+        recordedZones[cell] = zone;
+        recordedPopulation[cell] = pop;
+        recordedPollution[cell] = pollution;
+        recordedFlags[cell] = flags;
+        next = cell + 1;
+        count++;
+    }
+    dirtyCells.clear();
+
+    payload.clear();
+    putVarint(payload, zigzag(state.availableWorkers));
+    putVarint(payload, zigzag(state.availableGoods));
+    putVarint(payload, count);
+    payload.insert(payload.end(), entries.begin(), entries.end());
+    writeRecord(RecordKind::STEP, state.timeStep, payload);
+}
+
+bool StepReplayer::fail(const std::string& message) {
+    error = message;
+    return false;
+}
+
+bool StepReplayer::open(const std::string& path) {
+    error.clear();
+    records.clear();
+    if (!file.open(path)) return fail("cannot open " + path);
+    if (file.size() < HEADER_SIZE || std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return fail("not a step history");
+    }
+    uint32_t version;
+    std::memcpy(&version, file.data() + sizeof(MAGIC), sizeof(version));
+    if (version != StepRecorder::VERSION) return fail("unsupported step history version " + std::to_string(version));
+
+    // Index the records; a truncated last record (e.g. the run was killed)
+    // is dropped
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(file.data());
+    Reader reader = {begin + HEADER_SIZE, begin + file.size()};
+    while (reader.pos < reader.end) {
+        Record record;
+        record.kind = static_cast<RecordKind>(reader.byte());
+        record.step = static_cast<int>(reader.varint());
+        record.length = static_cast<std::size_t>(reader.varint());
+        record.offset = static_cast<std::size_t>(reader.pos - begin);
+        if (!reader.ok || record.length > static_cast<std::size_t>(reader.end - reader.pos)) break;
+        if (record.kind != RecordKind::KEYFRAME && record.kind != RecordKind::STEP) return fail("corrupt record");
+        if (records.empty() && record.kind != RecordKind::KEYFRAME) return fail("history does not start with a keyframe");
+        records.push_back(record);
+        reader.pos += record.length;
+    }
+    if (records.empty()) return fail("no records");
+    return true;
+}
+
+bool StepReplayer::applyStep(const Record& record, RegionGrid& grid, RegionState& state) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(file.data()) + record.offset;
+    Reader reader = {data, data + record.length};
+    state.timeStep = record.step;
+    state.availableWorkers = static_cast<int>(unzigzag(reader.varint()));
+    state.availableGoods = static_cast<int>(unzigzag(reader.varint()));
+    uint64_t count = reader.varint();
+
+    int width = grid.getWidth();
+    std::size_t cells = static_cast<std::size_t>(width) * grid.getHeight();
+    std::size_t cell = 0;
+    for (uint64_t i = 0; i < count && reader.ok; ++i) {
+        cell += static_cast<std::size_t>(reader.varint());
+        uint8_t fields = reader.byte();
+        if (cell >= cells) return fail("cell out of range at step " + std::to_string(record.step));
+
+        std::size_t gridCell = grid.index(static_cast<int>(cell % width), static_cast<int>(cell / width));
+        if (fields & ZONE) grid.writableZones()[gridCell] = reader.byte();
+        if (fields & POPULATION) grid.populations()[gridCell] = reader.byte();
+        if (fields & POLLUTION) grid.pollutionLevels()[gridCell] += static_cast<int>(unzigzag(reader.varint()));
+        if (fields & FLAGS) grid.flags()[gridCell] = reader.byte();
+        cell++;
+    }
+    if (!reader.ok) return fail("corrupt record at step " + std::to_string(record.step));
+    return true;
+}
+
+bool StepReplayer::seek(int step, RegionGrid& grid, RegionState& state) {
+    error.clear();
+    // Last record at or before step, then back to the keyframe it builds on
+    auto after = std::upper_bound(records.begin(), records.end(), step,
+                                  [](int target, const Record& record) { return target < record.step; });
+    if (after == records.begin() || (after - 1)->step != step) {
+        return fail("step " + std::to_string(step) + " is not recorded");
+    }
+    auto target = after - 1;
+    auto keyframe = target;
+    while (keyframe->kind != RecordKind::KEYFRAME) --keyframe;
+
+    RegionFile regionFile;
+    if (!regionFile.decode(file.data() + keyframe->offset, keyframe->length, grid, state)) {
+        return fail(regionFile.getError());
+    }
+    for (auto record = keyframe + 1; record <= target; ++record) {
+        if (!applyStep(*record, grid, state)) return false;
+    }
+    grid.rebuildDerivedState();
+    return true;
+}
@@ -0,0 +1,130 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "grid.h"
+#include "mappedfile.h"
+#include "regionfile.h"
+
+// Step history stream (.simdelta). After a 16-byte file header ("SIMDELTA",
+// version, reserved) the file is a sequence of records:
+//
+//    kind      1 byte: KEYFRAME or STEP
+//    step      varint time step
+//    length    varint payload size in bytes
+//    payload
+//
+// A keyframe payload is a complete .simregion image. A step payload holds
+// the resources (zigzag varints) and the cells that changed during that
+// step, in row-major order: a varint count, then per cell a varint gap
+// (cells skipped since the previous entry), a byte saying which fields
+// follow, and the new zone and population bytes, the pollution change as a
+// zigzag varint, and the flag byte, as present. Unchanged stretches of the
+// map therefore cost nothing but their gap.
+//
+// A step record is relative to the state after the previous record, so any
+// step can be rebuilt from the nearest keyframe at or before it.
+enum class RecordKind : uint8_t {
+    KEYFRAME = 1,
+    STEP = 2
+};
+
+// Appends one record per time step. Population, zone and flag changes are
+// reported by the simulation as they happen; for pollution it reports the
+// windows the pollution engine re-diffused, and only after a full pollution
+// pass are all rows compared against the last recorded values.
+class StepRecorder {
+public:
+    static const uint32_t VERSION = 1;
+    static const int DEFAULT_KEYFRAME_INTERVAL = 1000;
+
+    StepRecorder();
+
+    StepRecorder(const StepRecorder&) = delete;
+    StepRecorder& operator=(const StepRecorder&) = delete;
+
+    // Start a stream with a keyframe of the current state
+    bool open(const std::string& path, const RegionGrid& grid, const RegionState& state,
+              int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+    bool isOpen() const { return file.is_open(); }
+    void close();
+
+    // The population, zone or flags of (x, y) may have changed this step
+    void cellChanged(int x, int y) {
+        std::size_t cell = static_cast<std::size_t>(y) * width + x;
+        if (dirty[cell]) return;
+        dirty[cell] = 1;
+        dirtyCells.push_back(cell);
+    }
+
+    // The pollution of cells within radius of (x, y) may have changed
+    void areaChanged(int x, int y, int radius);
+
+    // The whole pollution plane was recomputed this step
+    void pollutionRecomputed() { pollutionPending = true; }
+
+    // Changes this step are not all reported (e.g. power was rerouted), so
+    // end it with a keyframe
+    void requestKeyframe() { keyframePending = true; }
+
+    // Append the record for the step that just finished
+    void endStep(const RegionGrid& grid, const RegionState& state);
+
+private:
+    std::ofstream file;
+    int keyframeInterval;
+    bool keyframePending;
+    bool pollutionPending;
+    int width;
+    int height;
+
+    // Values as of the last record
+    std::vector<uint8_t> recordedZones;
+    std::vector<uint8_t> recordedPopulation;
+    std::vector<int> recordedPollution;
+    std::vector<uint8_t> recordedFlags;
+
+    std::vector<uint8_t> dirty;
+    std::vector<std::size_t> dirtyCells;
+    std::vector<char> entries;
+    std::vector<char> payload;
+    std::vector<char> prefix;
+
+    void writeKeyframe(const RegionGrid& grid, const RegionState& state);
+    void writeRecord(RecordKind kind, int step, const std::vector<char>& bytes);
+    void remember(const RegionGrid& grid);
+};
+
+// Reads a step history and rebuilds the region at any recorded step
+class StepReplayer {
+public:
+    bool open(const std::string& path);
+
+    int firstStep() const { return records.empty() ? 0 : records.front().step; }
+    int lastStep() const { return records.empty() ? 0 : records.back().step; }
+
+    // Rebuild the state after the given step, which must be recorded
+    bool seek(int step, RegionGrid& grid, RegionState& state);
+
+    const std::string& getError() const { return error; }
+
+private:
+    struct Record {
+        RecordKind kind;
+        int step;
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    MappedFile file;
+    std::vector<Record> records;
+    std::string error;
+
+    bool fail(const std::string& message);
+    bool applyStep(const Record& record, RegionGrid& grid, RegionState& state);
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "regionfile.h"
+#include <cstring>
+#include <fstream>
+#include "mappedfile.h"
+
+namespace {
+
+const char MAGIC[8] = {'S', 'I', 'M', 'R', 'G', 'N', '\0', '\0'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t width;
+    int32_t height;
+    int32_t timeStep;
+    int32_t availableWorkers;
+    int32_t availableGoods;
+    uint32_t padding;
+    uint64_t randomSeed;
+    uint64_t randomCounter;
+    uint8_t reserved[8];
+};
+static_assert(sizeof(Header) == RegionFile::ALIGNMENT, "header must fill one block");
+
+std::size_t alignUp(std::size_t offset) {
+    return (offset + RegionFile::ALIGNMENT - 1) / RegionFile::ALIGNMENT * RegionFile::ALIGNMENT;
+}
+
+// Byte offsets of each section for a width x height region
+struct Layout {
+    std::size_t zones;
+    std::size_t population;
+    std::size_t pollution;
+    std::size_t flags;
+    std::size_t total;
+
+    Layout(std::size_t width, std::size_t height) {
+        std::size_t cells = width * height;
+        zones = sizeof(Header);
+        population = alignUp(zones + (cells * 3 + 7) / 8);
+        pollution = alignUp(population + cells);
+        flags = alignUp(pollution + cells * sizeof(int32_t));
+        total = flags + cells;
+    }
+};
+
+}
+
+bool RegionFile::fail(const std::string& message) {
+    error = message;
+    return false;
+}
+
+bool RegionFile::isRegionFile(const std::string& path) {
+    const std::string extension = ".simregion";
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+void RegionFile::encode(const RegionGrid& grid, const RegionState& state, std::vector<char>& out) {
+    std::size_t width = grid.getWidth();
+    std::size_t height = grid.getHeight();
+    Layout layout(width, height);
+    out.assign(layout.total, 0);
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.width = static_cast<int32_t>(width);
+    header.height = static_cast<int32_t>(height);
+    header.timeStep = state.timeStep;
+    header.availableWorkers = state.availableWorkers;
+    header.availableGoods = state.availableGoods;
+    header.randomSeed = state.randomSeed;
+    header.randomCounter = state.randomCounter;
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    uint8_t* zones = reinterpret_cast<uint8_t*>(out.data() + layout.zones);
+    std::size_t bit = 0;
+    for (std::size_t y = 0; y < height; ++y) {
+        const uint8_t* row = grid.zones() + grid.index(0, static_cast<int>(y));
+        for (std::size_t x = 0; x < width; ++x, bit += 3) {
+            // A 3-bit value can straddle two bytes
+            unsigned value = row[x] & 7u;
+            zones[bit / 8] |= static_cast<uint8_t>(value << (bit % 8));
+            if (bit % 8 > 5) {
+                zones[bit / 8 + 1] |= static_cast<uint8_t>(value >> (8 - bit % 8));
+            }
+        }
+    }
+
+    for (std::size_t y = 0; y < height; ++y) {
+        std::size_t cell = grid.index(0, static_cast<int>(y));
+        std::memcpy(out.data() + layout.population + y * width, grid.populations() + cell, width);
+        std::memcpy(out.data() + layout.pollution + y * width * sizeof(int32_t),
+                    grid.pollutionLevels() + cell, width * sizeof(int32_t));
+        std::memcpy(out.data() + layout.flags + y * width, grid.flags() + cell, width);
+    }
+}
+
+bool RegionFile::save(const std::string& path, const RegionGrid& grid, const RegionState& state) {
+    error.clear();
+    std::vector<char> image;
+    encode(grid, state, image);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return fail("cannot open " + path + " for writing");
+    file.write(image.data(), static_cast<std::streamsize>(image.size()));
+    if (!file) return fail("write to " + path + " failed");
+    return true;
+}
+
+bool RegionFile::load(const std::string& path, RegionGrid& grid, RegionState& state) {
+    error.clear();
+    MappedFile file;
+    if (!file.open(path)) return fail("cannot open " + path);
+    return decode(file.data(), file.size(), grid, state);
+}
+
+bool RegionFile::decode(const char* data, std::size_t size, RegionGrid& grid, RegionState& state) {
+    error.clear();
+    Header header;
+    if (size < sizeof(header)) return fail("truncated header");
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return fail("not a region file");
+    if (header.byteOrder != BYTE_ORDER_MARK) return fail("region file has the wrong byte order");
+    if (header.version != VERSION) return fail("unsupported region file version " + std::to_string(header.version));
+    if (header.width <= 0 || header.height <= 0) return fail("invalid region size");
+
+    std::size_t width = header.width;
+    std::size_t height = header.height;
+    Layout layout(width, height);
+    if (size < layout.total) return fail("truncated region data");
+
+    grid.resize(static_cast<int>(width), static_cast<int>(height));
+    const uint8_t* zones = reinterpret_cast<const uint8_t*>(data + layout.zones);
+    std::size_t bit = 0;
+    for (std::size_t y = 0; y < height; ++y) {
+        uint8_t* row = grid.writableZones() + grid.index(0, static_cast<int>(y));
+        for (std::size_t x = 0; x < width; ++x, bit += 3) {
+            unsigned value = zones[bit / 8] >> (bit % 8);
+            if (bit % 8 > 5) {
+                value |= static_cast<unsigned>(zones[bit / 8 + 1]) << (8 - bit % 8);
+            }
+            row[x] = static_cast<uint8_t>(value & 7u);
+        }
+    }
+
+    for (std::size_t y = 0; y < height; ++y) {
+        std::size_t cell = grid.index(0, static_cast<int>(y));
+        std::memcpy(grid.populations() + cell, data + layout.population + y * width, width);
+        std::memcpy(grid.pollutionLevels() + cell, data + layout.pollution + y * width * sizeof(int32_t),
+                    width * sizeof(int32_t));
+        std::memcpy(grid.flags() + cell, data + layout.flags + y * width, width);
+    }
+    grid.rebuildDerivedState();
+
+    state.timeStep = header.timeStep;
+    state.availableWorkers = header.availableWorkers;
+    state.availableGoods = header.availableGoods;
+    state.randomSeed = header.randomSeed;
+    state.randomCounter = header.randomCounter;
+    return true;
+}
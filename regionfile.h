@@ -0,0 +1,61 @@
+#ifndef REGIONFILE_H
+#define REGIONFILE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "grid.h"
+
+// Simulation counters stored alongside the grid
+struct RegionState {
+    int timeStep = 0;
+    int availableWorkers = 0;
+    int availableGoods = 0;
+
+    // Random source seed and counter
+    uint64_t randomSeed = 1;
+    uint64_t randomCounter = 0;
+};
+
+// Binary region format (.simregion), little-endian:
+//
+//    header      64 bytes: magic, version, byte-order mark, width, height,
+//                time step, available workers and goods, random state
+//    zones       3 bits per cell, row-major, packed LSB first
+//    population  1 byte per cell
+//    pollution   4 bytes per cell
+//    flags       1 byte per cell (RegionGrid::Flag bits)
+//
+// Every section starts on a 64-byte boundary. Loading maps the file and
+// decodes it into a RegionGrid rather than using it in place: the grid's
+// planes carry a halo and padded rows, so the zones are bit-unpacked cell by
+// cell and the population, pollution and flag planes are copied one row at
+// a time. The neighbor histograms, committed population and zone totals
+// are not stored; rebuildDerivedState() recomputes them after the copy.
+// There is no text parsing, but a load is still a pass over every cell.
+class RegionFile {
+public:
+    static const uint32_t VERSION = 3;
+    static const std::size_t ALIGNMENT = 64;
+
+    // Serialize into a byte image, reusing out's capacity
+    static void encode(const RegionGrid& grid, const RegionState& state, std::vector<char>& out);
+
+    bool save(const std::string& path, const RegionGrid& grid, const RegionState& state);
+    bool load(const std::string& path, RegionGrid& grid, RegionState& state);
+
+    // Load from an image produced by encode()
+    bool decode(const char* data, std::size_t size, RegionGrid& grid, RegionState& state);
+
+    const std::string& getError() const { return error; }
+
+    // Whether path names a binary region rather than a CSV layout
+    static bool isRegionFile(const std::string& path);
+
+private:
+    std::string error;
+
+    bool fail(const std::string& message);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "regiongen.h"
+#include "random.h"
+
+namespace {
+
+// Stream ids, kept apart so rows and districts never share a stream
+const uint64_t ROW_STREAMS = 0;
+const uint64_t DISTRICT_STREAMS = 1ull << 40;
+
+}
+
+ZoneType RegionGenerator::districtZone(int districtX, int districtY) const {
+    Random random = Random(seed).stream(DISTRICT_STREAMS + (static_cast<uint64_t>(districtY) << 20) + districtX);
+    uint32_t roll = random.below(100);
+    if (roll < 55) return ZoneType::RESIDENTIAL;
+    if (roll < 75) return ZoneType::COMMERCIAL;
+    return ZoneType::INDUSTRIAL;
+}
+
+void RegionGenerator::generate(RegionGrid& grid, int width, int height) const {
+    grid.resize(width, height);
+    uint8_t* zones = grid.writableZones();
+    const int corridor = BLOCK * CORRIDOR;
+    const int district = BLOCK * DISTRICT;
+
+    Random base(seed);
+    for (int y = 0; y < height; ++y) {
+        Random random = base.stream(ROW_STREAMS + y);
+        uint8_t* row = zones + grid.index(0, y);
+        for (int x = 0; x < width; ++x) {
+            ZoneType type;
+            bool streetX = x % BLOCK == 0;
+            bool streetY = y % BLOCK == 0;
+            if (streetX || streetY) {
+                // Streets, with power running along the corridor streets
+                bool powered = (streetX && x % corridor == 0) || (streetY && y % corridor == 0);
+                type = powered ? ZoneType::POWERLINE_OVER_ROAD : ZoneType::ROAD;
+            } else if (x % corridor == 1 && y % corridor == 1 &&
+                       (x / corridor + y / corridor) % 2 == 0) {
+                // A plant in the corner of every other corridor square
+                type = ZoneType::POWER_PLANT;
+            } else {
+                ZoneType main = districtZone(x / district, y / district);
+                uint32_t roll = random.below(100);
+                if (roll < 80) {
+                    type = main;
+                } else if (roll < 88) {
+                    type = static_cast<ZoneType>(random.below(3));  // R, I or C
+                } else if (roll < 94) {
+                    type = ZoneType::EMPTY;
+                } else if (main == ZoneType::INDUSTRIAL && x % BLOCK == BLOCK / 2) {
+                    type = ZoneType::POWERLINE;
+                } else {
+                    type = main;
+                }
+            }
+            row[x] = static_cast<uint8_t>(type);
+        }
+    }
+    grid.rebuildDerivedState();
+}
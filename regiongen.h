@@ -0,0 +1,28 @@
+#ifndef REGIONGEN_H
+#define REGIONGEN_H
+#include <cstdint>
+#include "grid.h"
+
+// Deterministic synthetic city layouts for benchmarks. The map is a street
+// grid of BLOCK-sized blocks; every CORRIDOR-th street carries a power line
+// (powerline over road), each corridor crossing region gets a power plant,
+// and blocks are grouped into districts that are mostly residential,
+// commercial or industrial with some mixing, empty lots and powerline
+// spurs. The same size and seed always give the same map.
+class RegionGenerator {
+public:
+    static const int BLOCK = 8;
+    static const int CORRIDOR = 4;        // Blocks between power corridors
+    static const int DISTRICT = 4;        // Blocks per district side
+
+    explicit RegionGenerator(uint64_t seed = 1) : seed(seed) {}
+
+    void generate(RegionGrid& grid, int width, int height) const;
+
+private:
+    uint64_t seed;
+
+    ZoneType districtZone(int districtX, int districtY) const;
+};
+
+#endif
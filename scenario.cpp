@@ -0,0 +1,137 @@
+#include "scenario.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "loader.h"
+#include "regionfile.h"
+
+namespace {
+
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+bool ScenarioRunner::fail(const std::string& message) {
+    error = message;
+    return false;
+}
+
+bool ScenarioRunner::loadLayout(const std::string& path) {
+    error.clear();
+    if (RegionFile::isRegionFile(path)) {
+        RegionFile regionFile;
+        RegionState state;
+        if (!regionFile.load(path, layout, state)) return fail(path + ": " + regionFile.getError());
+        return true;
+    }
+
+    RegionLoader loader;
+    if (!loader.loadCsv(path, layout)) {
+        return fail(path + ": " + (loader.getError().empty() ? "cannot open" : loader.getError()));
+    }
+    return true;
+}
+
+bool ScenarioRunner::readScenarios(const std::string& path, int defaultSteps) {
+    error.clear();
+    std::ifstream file(path);
+    if (!file) return fail("cannot open " + path);
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        Scenario scenario;
+        if (!(fields >> scenario.name) || scenario.name[0] == '#') continue;
+
+        if (!(fields >> scenario.seed)) {
+            return fail(path + ": line " + std::to_string(lineNumber) + ": expected a seed");
+        }
+        if (!(fields >> scenario.steps)) scenario.steps = defaultSteps;
+        scenarios.push_back(scenario);
+    }
+    if (scenarios.empty()) return fail(path + ": no scenarios");
+    return true;
+}
+
+void ScenarioRunner::run(int jobs) {
+    results.assign(scenarios.size(), ScenarioResult());
+    if (jobs <= 0) jobs = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    jobs = std::max(1, std::min(jobs, static_cast<int>(scenarios.size())));
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        CitySimulation sim(1);
+        sim.setQuiet(true);
+        for (size_t i = next.fetch_add(1); i < scenarios.size(); i = next.fetch_add(1)) {
+            const Scenario& scenario = scenarios[i];
+            auto start = std::chrono::steady_clock::now();
+            sim.loadRegion(layout);
+            sim.setMaxTimeSteps(scenario.steps);
+            sim.setSeed(scenario.seed);
+            sim.runSimulation();
+
+            ScenarioResult& result = results[i];
+            result.scenario = scenario;
+            result.stats = sim.finalStats();
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < jobs; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+bool ScenarioRunner::writeReport(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    bool json = endsWith(path, ".json");
+    if (json) {
+        file << "{\"scenarios\": [\n";
+    } else {
+        file << "name,seed,steps,time_steps,residential,industrial,commercial,pollution,alien_invaded,"
+             << "available_workers,available_goods,seconds\n";
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ScenarioResult& result = results[i];
+        const CitySimulation::FinalStats& stats = result.stats;
+        if (json) {
+            file << "  {\"name\": " << jsonString(result.scenario.name) << ", \"seed\": " << result.scenario.seed
+                 << ", \"steps\": " << result.scenario.steps << ", \"time_steps\": " << stats.timeSteps
+                 << ", \"residential\": " << stats.residential << ", \"industrial\": " << stats.industrial
+                 << ", \"commercial\": " << stats.commercial << ", \"pollution\": " << stats.pollution
+                 << ", \"alien_invaded\": " << stats.alienInvaded << ", \"available_workers\": "
+                 << stats.availableWorkers << ", \"available_goods\": " << stats.availableGoods
+                 << ", \"seconds\": " << result.seconds << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        } else {
+            file << result.scenario.name << "," << result.scenario.seed << "," << result.scenario.steps << ","
+                 << stats.timeSteps << "," << stats.residential << "," << stats.industrial << ","
+                 << stats.commercial << "," << stats.pollution << "," << stats.alienInvaded << ","
+                 << stats.availableWorkers << "," << stats.availableGoods << "," << result.seconds << "\n";
+        }
+    }
+    if (json) file << "]}\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,56 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "grid.h"
+#include "simulation.h"
+
+// One run of a scenario sweep
+struct Scenario {
+    std::string name;
+    uint64_t seed = 1;
+    int steps = 0;
+};
+
+struct ScenarioResult {
+    Scenario scenario;
+    CitySimulation::FinalStats stats;
+    double seconds = 0;
+};
+
+// Runs many independent simulations of one layout concurrently. The layout
+// is parsed once; every simulation starts from a copy of it that shares the
+// zone plane, so only the mutable planes are per run. Each worker thread
+// keeps one CitySimulation and reuses it (and its buffers) for every
+// scenario it picks up, running it single-threaded and quiet, since the
+// parallelism is across scenarios.
+class ScenarioRunner {
+public:
+    // Load the shared layout (.csv or .simregion)
+    bool loadLayout(const std::string& path);
+
+    // Read "name seed [steps]" lines; blank lines and # comments are skipped
+    // and steps defaults to defaultSteps
+    bool readScenarios(const std::string& path, int defaultSteps);
+    void addScenario(const Scenario& scenario) { scenarios.push_back(scenario); }
+
+    // Run every scenario on `jobs` threads (0 = one per core)
+    void run(int jobs);
+
+    // Write the results as JSON if path ends in .json, otherwise CSV
+    bool writeReport(const std::string& path) const;
+
+    const std::vector<ScenarioResult>& getResults() const { return results; }
+    const std::string& getError() const { return error; }
+
+private:
+    RegionGrid layout;
+    std::vector<Scenario> scenarios;
+    std::vector<ScenarioResult> results;
+    std::string error;
+
+    bool fail(const std::string& message);
+};
+
+#endif
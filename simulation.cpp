@@ -1,344 +1,908 @@
-#include "simulation.h"  
-#include <fstream>  
-#include <iostream>  
-#include <sstream>  
-#include <algorithm>  
-#include <cmath>  
-using namespace std;  
-  
-bool CitySimulation::loadConfiguration(const string& filename) {  
-   ifstream file(filename);  
-   if (!file) return false;  
-  
-   string layoutFile;  
-   getline(file, layoutFile);  
-   file >> maxTimeSteps >> refreshRate;  
-  
-   return loadRegionLayout(layoutFile);  
-}  
-  
-bool CitySimulation::loadRegionLayout(const string& filename) {  
-   ifstream file(filename);  
-   if (!file) return false;  
-  
-   string line;  
-   while (getline(file, line)) {  
-      vector<Cell> row;  
-      stringstream ss(line);  
-      string cell;  
-       
-      while (getline(ss, cell, ',')) {  
-        if (cell.empty()) continue;  
-          
-        ZoneType type;  
-        switch (cell[0]) {  
-           case 'R': type = ZoneType::RESIDENTIAL; break;  
-           case 'I': type = ZoneType::INDUSTRIAL; break;  
-           case 'C': type = ZoneType::COMMERCIAL; break;  
-           case '-': type = ZoneType::ROAD; break;  
-           case 'T': type = ZoneType::POWERLINE; break;  
-           case '#': type = ZoneType::POWERLINE_OVER_ROAD; break;  
-           case 'P': type = ZoneType::POWER_PLANT; break;  
-           default: type = ZoneType::EMPTY;  
-        }  
-        row.push_back(Cell(type));  
-      }  
-      if (!row.empty()) {  
-        region.push_back(row);  
-        pollution.push_back(vector<int>(row.size(), 0));  
-      }  
-   }  
-  
-   availableWorkers = 0;  
-   availableGoods = 0;  
-   return true;  
-}  
-  
-void CitySimulation::simulateTimeStep() {  
-   calculateResources();  
-   updatePollution();  
-   growCells();  
-   handleAlienInvasion();  
-}  
-  
-void CitySimulation::printRegionState() {  
-   for (int i = 0; i < region.size(); ++i) {  
-      for (int j = 0; j < region[i].size(); ++j) {  
-        const Cell& cell = region[i][j];  
-        if (cell.getPopulation() == 0) {  
-           switch (cell.getType()) {  
-              case ZoneType::RESIDENTIAL: cout << "R"; break;  
-              case ZoneType::INDUSTRIAL: cout << "I"; break;  
-              case ZoneType::COMMERCIAL: cout << "C"; break;  
-              case ZoneType::ROAD: cout << "-"; break;  
-              case ZoneType::POWERLINE: cout << "T"; break;  
-              case ZoneType::POWERLINE_OVER_ROAD: cout << "#"; break;  
-              case ZoneType::POWER_PLANT: cout << "P"; break;  
-              default: cout << " ";  
-           }  
-        } else {  
-           cout << cell.getPopulation();  
-        }  
-        if (j < region[i].size() - 1) cout << ",";  
-      }  
-      cout << endl;  
-   }  
-   cout << endl;  
-}  
-  
-void CitySimulation::runSimulation() {  
-   printRegionState();  
-    
-   vector<vector<Cell>> previousState;  
-   for (currentTimeStep = 1; currentTimeStep <= maxTimeSteps; ++currentTimeStep) {  
-      previousState = region;  
-      simulateTimeStep();  
-       
-      if (currentTimeStep % refreshRate == 0) {  
-        cout << "Time step: " << currentTimeStep << endl;  
-        cout << "Available workers: " << availableWorkers << endl;  
-        cout << "Available goods: " << availableGoods << endl;  
-        printRegionState();  
-      }  
-  
-      if (!hasChanged(previousState)) break;  
-   }  
-}  
-  
-void CitySimulation::calculateResources() {  
-   availableWorkers = 0;  
-   availableGoods = 0;  
-    
-   for (const auto& row : region) {  
-      for (const Cell& cell : row) {  
-        if (cell.getType() == ZoneType::RESIDENTIAL) {  
-           availableWorkers += cell.getPopulation();  
-        }  
-      }  
-   }  
-    
-   for (const auto& row : region) {  
-      for (const Cell& cell : row) {  
-        if (cell.getType() == ZoneType::INDUSTRIAL) {  
-           availableGoods += cell.getPopulation();  
-        }  
-      }  
-   }  
-}  
-  
-bool CitySimulation::hasChanged(const vector<vector<Cell>>& previousState) {  
-   if (region.size() != previousState.size()) return true;  
-    
-   for (int i = 0; i < region.size(); ++i) {  
-      if (region[i].size() != previousState[i].size()) return true;  
-      for (int j = 0; j < region[i].size(); ++j) {  
-        if (region[i][j].getPopulation() != previousState[i][j].getPopulation()) {  
-           return true;  
-        }  
-      }  
-   }  
-   return false;  
-}  
-  
-bool CitySimulation::isValidCoordinate(int x, int y) const {  
-   return y >= 0 && y < region.size() &&  
-        x >= 0 && x < region[y].size();  
-}  
-  
-int CitySimulation::getAdjacentPopulation(int x, int y, int minPop) const {  
-   int total = 0;  
-   for (int dy = -1; dy <= 1; ++dy) {  
-      for (int dx = -1; dx <= 1; ++dx) {  
-        if (dx == 0 && dy == 0) continue;  
-          
-        int newX = x + dx;  
-        int newY = y + dy;  
-          
-        if (isValidCoordinate(newX, newY)) {  
-           const Cell& neighbor = region[newY][newX];  
-           if (neighbor.getPopulation() >= minPop) {  
-              total++;  
-           }  
-        }  
-      }  
-   }  
-   return total;  
-}  
-  
-void CitySimulation::updatePollution() {  
-   vector<vector<int>> newPollution(region.size(),  
-      vector<int>(region[0].size(), 0));  
-    
-   for (int y = 0; y < region.size(); ++y) {  
-      for (int x = 0; x < region[y].size(); ++x) {  
-        if (region[y][x].getType() == ZoneType::INDUSTRIAL) {  
-           int pollutionLevel = region[y][x].getPopulation();  
-           for (int dy = -3; dy <= 3; ++dy) {  
-              for (int dx = -3; dx <= 3; ++dx) {  
-                int newY = y + dy;  
-                int newX = x + dx;  
-                if (isValidCoordinate(newX, newY)) {  
-                   int distance = max(abs(dx), abs(dy));  
-                   int spreadPollution = max(0, pollutionLevel - distance);  
-                   newPollution[newY][newX] += spreadPollution;  
-                }  
-              }  
-           }  
-        }  
-      }  
-   }  
-    
-   pollution = newPollution;  
-}  
-  
-void CitySimulation::growCells() {  
-   std::vector<std::pair<int, int>> commercialCells;  
-   std::vector<std::pair<int, int>> industrialCells;  
-   std::vector<std::pair<int, int>> residentialCells;  
-    
-   // Identify cells that can potentially grow  
-   for (int y = 0; y < static_cast<int>(region.size()); ++y) {  
-      for (int x = 0; x < static_cast<int>(region[y].size()); ++x) {  
-        Cell& cell = region[y][x];  
-        switch (cell.getType()) {  
-           case ZoneType::COMMERCIAL: commercialCells.push_back({x, y}); break;  
-           case ZoneType::INDUSTRIAL: industrialCells.push_back({x, y}); break;  
-           case ZoneType::RESIDENTIAL: residentialCells.push_back({x, y}); break;  
-           default: break;  
-        }  
-      }  
-   }  
-  
-   // Sort cells based on priority rules (this code remains unchanged)  
-   auto sortCells = [this](const std::pair<int, int>& a, const std::pair<int, int>& b) {  
-      Cell& cellA = region[a.second][a.first];  
-      Cell& cellB = region[b.second][b.first];  
-       
-      if (cellA.getPopulation() != cellB.getPopulation())  
-        return cellA.getPopulation() > cellB.getPopulation();  
-          
-      int popA = getAdjacentPopulation(a.first, a.second, 1);  
-      int popB = getAdjacentPopulation(b.first, b.second, 1);  
-      if (popA != popB)  
-        return popA > popB;  
-          
-      if (a.second != b.second)  
-        return a.second < b.second;  
-          
-      return a.first < b.first;  
-   };  
-    
-   std::sort(commercialCells.begin(), commercialCells.end(), sortCells);  
-   std::sort(industrialCells.begin(), industrialCells.end(), sortCells);  
-   std::sort(residentialCells.begin(), residentialCells.end(), sortCells);  
-  
-   // Process commercial zones  
-   for (const auto& [x, y] : commercialCells) {  
-      Cell& cell = region[y][x];  
-      int pop = cell.getPopulation();  
-      int adjPop = getAdjacentPopulation(x, y, pop);  
-       
-      bool hasPowerline = false;  
-      for (int dy = -1; dy <= 1; ++dy) {  
-        for (int dx = -1; dx <= 1; ++dx) {  
-           if (isValidCoordinate(x + dx, y + dy)) {  
-              Cell& neighbor = region[y + dy][x + dx];  
-              if (neighbor.getType() == ZoneType::POWERLINE ||  
-                neighbor.getType() == ZoneType::POWERLINE_OVER_ROAD ||  
-                neighbor.getType() == ZoneType::POWER_PLANT) {  
-                hasPowerline = true;  
-                break;  
-              }  
-           }  
-        }  
-        if (hasPowerline) break;  
-      }  
-  
-      // Modified Commercial growth conditions with reduced requirements  
-      if ((pop == 0 && (hasPowerline || adjPop >= 1) && availableWorkers >= 1 && availableGoods >= 1) ||  
-        (pop == 1 && adjPop >= 1 && availableWorkers >= 1 && availableGoods >= 1)) {  
-        cell.setPopulation(pop + 1);  
-        availableWorkers--;  
-        availableGoods--;  
-      }  
-   }  
-  
-   // Process industrial zones  
-   for (const auto& [x, y] : industrialCells) {  
-      Cell& cell = region[y][x];  
-      int pop = cell.getPopulation();  
-      int adjPop = getAdjacentPopulation(x, y, pop);  
-       
-      bool hasPowerline = false;  
-      for (int dy = -1; dy <= 1; ++dy) {  
-        for (int dx = -1; dx <= 1; ++dx) {  
-           if (isValidCoordinate(x + dx, y + dy)) {  
-              Cell& neighbor = region[y + dy][x + dx];  
-              if (neighbor.getType() == ZoneType::POWERLINE ||  
-                neighbor.getType() == ZoneType::POWERLINE_OVER_ROAD ||  
-                neighbor.getType() == ZoneType::POWER_PLANT) {  
-                hasPowerline = true;  
-                break;  
-              }  
-           }  
-        }  
-        if (hasPowerline) break;  
-      }  
-  
-      // Modified Industrial growth conditions with reduced worker requirements  
-      if ((pop == 0 && (hasPowerline || adjPop >= 1) && availableWorkers >= 1) ||  
-        (pop == 1 && adjPop >= 2 && availableWorkers >= 1)) {  
-        cell.setPopulation(pop + 1);  
-        availableWorkers--; // Decreased workers requirement per step  
-      }  
-   }  
-  
-   // Process residential zones  
-   for (const auto& [x, y] : residentialCells) {  
-      Cell& cell = region[y][x];  
-      int pop = cell.getPopulation();  
-      int adjPop = getAdjacentPopulation(x, y, pop);  
-       
-      bool hasPowerline = false;  
-      for (int dy = -1; dy <= 1; ++dy) {  
-        for (int dx = -1; dx <= 1; ++dx) {  
-           if (isValidCoordinate(x + dx, y + dy)) {  
-              Cell& neighbor = region[y + dy][x + dx];  
-              if (neighbor.getType() == ZoneType::POWERLINE ||  
-                neighbor.getType() == ZoneType::POWERLINE_OVER_ROAD ||  
-                neighbor.getType() == ZoneType::POWER_PLANT) {  
-                hasPowerline = true;  
-                break;  
-              }  
-           }  
-        }  
-        if (hasPowerline) break;  
-      }  
-  
-      // Residential growth conditions  
-      if ((pop == 0 && (hasPowerline || adjPop >= 1)) ||  
-        (pop == 1 && adjPop >= 2) ||  
-        (pop == 2 && adjPop >= 3) ||  // Reduced adjacent population requirements for faster growth  
-        (pop == 3 && adjPop >= 4)) {  
-        cell.setPopulation(pop + 1);  
-      }  
-   }  
-}  
-  
+#include "simulation.h"
+#include "growthrules.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+using namespace std;
+
+CitySimulation::CitySimulation(int threads) : executor(threads) {}
+
+bool CitySimulation::loadConfiguration(const string& filename, bool resume) {
+   return readConfiguration(filename) && load(resume);
+}
+
+bool CitySimulation::readConfiguration(const string& filename) {
+   ifstream file(filename);
+   if (!file) return false;
+
+   getline(file, regionFile);
+   file >> maxTimeSteps >> refreshRate;
+
+   // Optional: checkpoint interval, then checkpoint path, and seed=N
+   // anywhere among them
+   string base = filename.substr(0, filename.find_last_of('.'));
+   checkpointInterval = 0;
+   checkpointPath = base + ".checkpoint.simregion";
+   int positional = 0;
+   string token;
+   while (file >> token) {
+      if (token.compare(0, 5, "seed=") == 0) {
+        setSeed(strtoull(token.c_str() + 5, nullptr, 10));
+      } else if (positional++ == 0) {
+        checkpointInterval = atoi(token.c_str());
+      } else {
+        checkpointPath = token;
+      }
+   }
+   return true;
+}
+
+bool CitySimulation::load(bool resume) {
+   if (resume && !checkpointPath.empty() && ifstream(checkpointPath)) {
+      return loadRegion(checkpointPath);
+   }
+   return loadRegion(regionFile);
+}
+
+void CitySimulation::setRegionFile(const string& filename) {
+   regionFile = filename;
+}
+
+void CitySimulation::setMaxTimeSteps(int steps) {
+   maxTimeSteps = steps;
+}
+
+void CitySimulation::setRefreshRate(int rate) {
+   refreshRate = rate;
+}
+
+void CitySimulation::setCheckpoint(int interval, const string& filename) {
+   checkpointInterval = interval;
+   checkpointPath = filename;
+}
+
+void CitySimulation::setStopOnCycle(bool on) {
+   stopOnCycle = on;
+}
+
+void CitySimulation::setSeed(uint64_t seed) {
+   random.reseed(seed);
+}
+
+bool CitySimulation::loadRegion(const string& filename) {
+   if (!RegionFile::isRegionFile(filename)) {
+      return loadRegionLayout(filename);
+   }
+
+   RegionFile file;
+   RegionState state;
+   if (!file.load(filename, region, state)) {
+      cerr << filename << ": " << file.getError() << endl;
+      region.clear();
+      return false;
+   }
+
+   // The stored pollution plane is kept as is; the engine resyncs on its
+   // next update
+   powerNetwork.build(region);
+   pollutionEngine.invalidate();
+   frontierValid = false;
+   stateHash.reset(region);
+   cycles.clear();
+   cyclePeriod = 0;
+
+   currentTimeStep = state.timeStep;
+   availableWorkers = state.availableWorkers;
+   availableGoods = state.availableGoods;
+   lastStepChanges = 0;
+
+   // Put the random source back where it was when the region was saved
+   random.reseed(state.randomSeed);
+   random.setCounter(state.randomCounter);
+   return true;
+}
+
+bool CitySimulation::saveRegion(const string& filename) const {
+   if (!RegionFile::isRegionFile(filename)) {
+      return RegionLoader::saveCsv(filename, region);
+   }
+
+   RegionFile file;
+   if (!file.save(filename, region, captureState())) {
+      cerr << filename << ": " << file.getError() << endl;
+      return false;
+   }
+   return true;
+}
+
+RegionState CitySimulation::captureState() const {
+   RegionState state;
+   state.timeStep = currentTimeStep;
+   state.availableWorkers = availableWorkers;
+   state.availableGoods = availableGoods;
+   state.randomSeed = random.getSeed();
+   state.randomCounter = random.getCounter();
+   return state;
+}
+
+bool CitySimulation::loadRegionLayout(const string& filename) {
+   RegionLoader loader;
+   if (!loader.loadCsv(filename, region)) {
+      if (!loader.getError().empty()) {
+        cerr << filename << ": " << loader.getError() << endl;
+      }
+      return false;
+   }
+   startFromLayout();
+   return true;
+}
+
+bool CitySimulation::loadRegion(const RegionGrid& layout) {
+   if (layout.empty()) return false;
+
+   // The copy shares the layout's zone plane until a zone is changed
+   region = layout;
+   startFromLayout();
+   return true;
+}
+
+void CitySimulation::startFromLayout() {
+   powerNetwork.build(region);
+   pollutionEngine.invalidate();
+   frontierValid = false;
+   stateHash.reset(region);
+   cycles.clear();
+   cyclePeriod = 0;
+
+   currentTimeStep = 0;
+   availableWorkers = 0;
+   availableGoods = 0;
+   lastStepChanges = 0;
+}
+
+void CitySimulation::setQuiet(bool on) {
+   quiet = on;
+   output.setEnabled(!on);
+}
+
+void CitySimulation::simulateTimeStep() {
+   calculateResources();
+   updatePollution();
+   growCells();
+   handleAlienInvasion();
+
+   SIMCITY_PROFILE_SCOPE(profiler, SWAP);
+   lastStepChanges = region.swapBuffers();
+}
+
+void CitySimulation::printRegionState() {
+   output.writeRegion(region);
+}
+
+bool CitySimulation::setOutputFile(const string& filename) {
+   return output.open(filename);
+}
+
+bool CitySimulation::recordHistory(const string& filename, int keyframeInterval) {
+   if (!recorder.open(filename, region, captureState(), keyframeInterval)) return false;
+   pollutionEngine.setTracking(true);
+   return true;
+}
+
+void CitySimulation::setOutputMode(RegionWriter::Mode mode) {
+   output.setMode(mode);
+}
+
+void CitySimulation::runSimulation() {
+   {
+      SIMCITY_PROFILE_SCOPE(profiler, OUTPUT);
+      printRegionState();
+   }
+   cycles.record(stateHash.getValue(), currentTimeStep);
+
+   // currentTimeStep counts completed steps, so a region loaded from a
+   // binary file carries on where it was saved
+   while (currentTimeStep < maxTimeSteps) {
+      SIMCITY_PROFILE_BEGIN_STEP(profiler);
+      ++currentTimeStep;
+      simulateTimeStep();
+      {
+        SIMCITY_PROFILE_SCOPE(profiler, RECORD);
+        recorder.endStep(region, captureState());
+      }
+
+      if (refreshRate > 0 && currentTimeStep % refreshRate == 0) {
+        SIMCITY_PROFILE_SCOPE(profiler, OUTPUT);
+        output.text("Time step: ").number(currentTimeStep).newline();
+        output.text("Available workers: ").number(availableWorkers).newline();
+        output.text("Available goods: ").number(availableGoods).newline();
+        printRegionState();
+      }
+
+      if (checkpointInterval > 0 && currentTimeStep % checkpointInterval == 0) {
+        SIMCITY_PROFILE_SCOPE(profiler, CHECKPOINT);
+        checkpointWriter.submit(checkpointPath, region, captureState());
+      }
+      SIMCITY_PROFILE_END_STEP(profiler);
+
+      if (!hasChanged()) break;
+
+      // A state seen a few steps ago means the run is going round in a
+      // cycle (a repeat of the last step is the no-change case above)
+      int period = cycles.record(stateHash.getValue(), currentTimeStep);
+      if (period > 0 && cyclePeriod == 0) {
+        cyclePeriod = period;
+        output.text("Time step ").number(currentTimeStep).text(" repeats time step ")
+              .number(currentTimeStep - period).text(" (cycle period ").number(period).text(")").newline();
+        // Reported once per run; flush so it reaches the stream at its step
+        output.flush();
+      }
+      if (period > 0 && stopOnCycle) break;
+   }
+   checkpointWriter.flush();
+
+#ifdef SIMCITY_PROFILE
+   if (!quiet) profiler.report(cerr);
+   if (!traceFile.empty() && !profiler.writeTrace(traceFile)) {
+      cerr << "Cannot write trace " << traceFile << endl;
+   }
+#endif
+}
+
+bool CitySimulation::setTraceFile(const string& filename) {
+#ifdef SIMCITY_PROFILE
+   traceFile = filename;
+   profiler.setTracing(!filename.empty());
+   return true;
+#else
+   (void)filename;
+   return false;
+#endif
+}
+
+void CitySimulation::calculateResources() {
+   SIMCITY_PROFILE_SCOPE(profiler, RESOURCES);
+   // The grid keeps per-zone totals current on every population write
+   availableWorkers = static_cast<int>(region.getTotalPopulation(ZoneType::RESIDENTIAL));
+   availableGoods = static_cast<int>(region.getTotalPopulation(ZoneType::INDUSTRIAL));
+
+#ifdef SIMCITY_CHECK_RESOURCES
+   int countedWorkers, countedGoods;
+   recountResources(countedWorkers, countedGoods);
+   if (countedWorkers != availableWorkers || countedGoods != availableGoods) {
+      cerr << "Resource totals drifted at time step " << currentTimeStep << ": workers "
+          << availableWorkers << " vs " << countedWorkers << ", goods "
+          << availableGoods << " vs " << countedGoods << endl;
+      abort();
+   }
+#endif
+}
+
+void CitySimulation::recountResources(int& workers, int& goods) {
+   // Per-band partial sums, combined in band order
+   int bands = executor.bandCount(region.getHeight());
+   bandTotals.assign(bands, {0, 0});
+   executor.forEachBand(region.getHeight(), [this](int band, int begin, int end) {
+      const uint8_t* zones = region.zones();
+      const uint8_t* pops = region.populations();
+      int bandWorkers = 0;
+      int bandGoods = 0;
+      for (int y = begin; y < end; ++y) {
+        size_t rowStart = region.index(0, y);
+        for (int x = 0; x < region.getWidth(); ++x) {
+           ZoneType type = static_cast<ZoneType>(zones[rowStart + x]);
+           if (type == ZoneType::RESIDENTIAL) {
+              bandWorkers += pops[rowStart + x];
+           } else if (type == ZoneType::INDUSTRIAL) {
+              bandGoods += pops[rowStart + x];
+           }
+        }
+      }
+      bandTotals[band] = {bandWorkers, bandGoods};
+   });
+
+   workers = 0;
+   goods = 0;
+   for (const auto& [bandWorkers, bandGoods] : bandTotals) {
+      workers += bandWorkers;
+      goods += bandGoods;
+   }
+}
+
+void CitySimulation::setThreadCount(int threads) {
+   executor.setThreadCount(threads);
+}
+
+void CitySimulation::setGrowthMode(GrowthMode mode) {
+   growthMode = mode;
+}
+
+bool CitySimulation::hasChanged() const {
+   return lastStepChanges != 0;
+}
+
+bool CitySimulation::isValidCoordinate(int x, int y) const {
+   return region.isValidCoordinate(x, y);
+}
+
+int CitySimulation::getAdjacentPopulation(int x, int y, int minPop) const {
+   return region.countNeighborsAtLeast(x, y, minPop);
+}
+
+void CitySimulation::updatePollution() {
+   SIMCITY_PROFILE_SCOPE(profiler, POLLUTION);
+   // Only industrial cells changed since the last update are re-diffused
+   pollutionEngine.update(region, executor);
+   if (recorder.isOpen()) {
+      // Hand the rewritten windows to the recorder so it need not diff the plane
+      if (pollutionEngine.recomputedAll()) {
+         recorder.pollutionRecomputed();
+      } else {
+         for (const auto& [x, y] : pollutionEngine.rediffusedSources()) {
+            recorder.areaChanged(x, y, PollutionEngine::RADIUS);
+         }
+      }
+      pollutionEngine.clearChanges();
+   }
+}
+
+void CitySimulation::setPopulation(int x, int y, int pop) {
+   // Every population change made by the simulation goes through here
+   int oldPop = region.getPopulation(x, y);
+   if (oldPop == pop) return;
+   region.setPopulation(x, y, pop);
+   if (region.getType(x, y) == ZoneType::INDUSTRIAL) {
+      pollutionEngine.sourceChanged(region, x, y);
+   }
+   size_t cell = region.index(x, y);
+   stateHash.populationChanged(cell, oldPop, pop);
+   if (frontierValid && !dirtyMark[cell]) {
+      dirtyMark[cell] = 1;
+      dirtyCells.push_back(static_cast<int>(cell));
+   }
+   if (recorder.isOpen()) {
+      recorder.cellChanged(x, y);
+   }
+}
+
+int CitySimulation::priorityKey(int x, int y) const {
+   // Ascending key = population desc, then adjacent population desc
+   int pop = region.getPopulation(x, y);
+   int adjPop = getAdjacentPopulation(x, y, 1);
+   return (MAX_POPULATION - pop) * (MAX_NEIGHBORS + 1) + (MAX_NEIGHBORS - adjPop);
+}
+
+void CitySimulation::orderCandidates(vector<GrowthCandidate>& cells) {
+   // Stable counting sort over the bounded key range
+   bucketCounts.assign(PRIORITY_KEYS + 1, 0);
+   for (const GrowthCandidate& cell : cells) {
+      bucketCounts[cell.key + 1]++;
+   }
+   for (int key = 0; key < PRIORITY_KEYS; ++key) {
+      bucketCounts[key + 1] += bucketCounts[key];
+   }
+
+   sortScratch.resize(cells.size());
+   for (const GrowthCandidate& cell : cells) {
+      sortScratch[bucketCounts[cell.key]++] = cell;
+   }
+   cells.swap(sortScratch);
+}
+
+void CitySimulation::collectCandidates(CandidateLists& lists, int beginRow, int endRow) const {
+   lists.commercial.clear();
+   lists.industrial.clear();
+   lists.residential.clear();
+   for (int y = beginRow; y < endRow; ++y) {
+      for (int x = 0; x < region.getWidth(); ++x) {
+        ZoneType type = region.getType(x, y);
+        if (type != ZoneType::COMMERCIAL && type != ZoneType::INDUSTRIAL &&
+           type != ZoneType::RESIDENTIAL) {
+           continue;
+        }
+
+        GrowthCandidate candidate{x, y, priorityKey(x, y)};
+        switch (type) {
+           case ZoneType::COMMERCIAL: lists.commercial.push_back(candidate); break;
+           case ZoneType::INDUSTRIAL: lists.industrial.push_back(candidate); break;
+           default: lists.residential.push_back(candidate); break;
+        }
+      }
+   }
+}
+
+void CitySimulation::collectEligible(CandidateLists& lists, int begin, int end) {
+   lists.commercial.clear();
+   lists.industrial.clear();
+   lists.residential.clear();
+   int stride = region.getStride();
+   const uint8_t* zones = region.zones();
+   for (int i = begin; i < end; ++i) {
+      int cell = eligibleCells[i];
+      listedStamp[cell] = growthStamp;
+      GrowthCandidate candidate{cell % stride - RegionGrid::HALO, cell / stride - RegionGrid::HALO, 0};
+      candidate.key = priorityKey(candidate.x, candidate.y);
+      switch (static_cast<ZoneType>(zones[cell])) {
+        case ZoneType::COMMERCIAL: lists.commercial.push_back(candidate); break;
+        case ZoneType::INDUSTRIAL: lists.industrial.push_back(candidate); break;
+        default: lists.residential.push_back(candidate); break;
+      }
+   }
+}
+
+void CitySimulation::collectAll() {
+   // Identify cells that can potentially grow, one row band per thread
+   int bands = executor.bandCount(region.getHeight());
+   if (static_cast<int>(bandCandidates.size()) < bands) {
+      bandCandidates.resize(bands);
+   }
+   executor.forEachBand(region.getHeight(), [this](int band, int begin, int end) {
+      collectCandidates(bandCandidates[band], begin, end);
+   });
+   mergeCandidates(bands);
+}
+
+void CitySimulation::collectFrontier() {
+   // Only cells passing their rule at the start of the step can grow
+   // unless woken later in the step
+   refreshFrontier();
+   ++growthStamp;
+   for (vector<int>& woken : wokenLater) {
+      woken.clear();
+   }
+
+   int count = static_cast<int>(eligibleCells.size());
+   int bands = executor.bandCount(count);
+   if (static_cast<int>(bandCandidates.size()) < bands) {
+      bandCandidates.resize(bands);
+   }
+   executor.forEachBand(count, [this](int band, int begin, int end) {
+      collectEligible(bandCandidates[band], begin, end);
+   });
+   mergeCandidates(bands);
+}
+
+void CitySimulation::mergeCandidates(int bands) {
+   // Bands are joined in order, so each list is already in (y asc, x asc)
+   // order and a stable sort on the remaining key fields gives the full
+   // priority order
+   commercialCells.clear();
+   industrialCells.clear();
+   residentialCells.clear();
+   for (int band = 0; band < bands; ++band) {
+      const CandidateLists& lists = bandCandidates[band];
+      commercialCells.insert(commercialCells.end(), lists.commercial.begin(), lists.commercial.end());
+      industrialCells.insert(industrialCells.end(), lists.industrial.begin(), lists.industrial.end());
+      residentialCells.insert(residentialCells.end(), lists.residential.begin(), lists.residential.end());
+   }
+
+   // Each candidate's priority key counted its neighbors once
+   SIMCITY_PROFILE_COUNT(profiler, CANDIDATES,
+                    commercialCells.size() + industrialCells.size() + residentialCells.size());
+   SIMCITY_PROFILE_COUNT(profiler, NEIGHBOR_LOOKUPS,
+                    commercialCells.size() + industrialCells.size() + residentialCells.size());
+}
+
+void CitySimulation::orderAllCandidates() {
+   // Order by population desc, then adjacent population desc
+   orderCandidates(commercialCells);
+   orderCandidates(industrialCells);
+   orderCandidates(residentialCells);
+}
+
+void CitySimulation::rebuildFrontier() {
+   size_t cells = region.size();
+   eligible.assign(cells, 0);
+   dirtyMark.assign(cells, 0);
+   dirtyCells.clear();
+   if (listedStamp.size() != cells) {
+      listedStamp.assign(cells, 0);
+   }
+
+   int bands = executor.bandCount(region.getHeight());
+   if (static_cast<int>(bandEligible.size()) < bands) {
+      bandEligible.resize(bands);
+   }
+   executor.forEachBand(region.getHeight(), [this](int band, int begin, int end) {
+      vector<int>& found = bandEligible[band];
+      found.clear();
+      for (int y = begin; y < end; ++y) {
+        for (int x = 0; x < region.getWidth(); ++x) {
+           ZoneType type = region.getType(x, y);
+           if (growthPhase(type) >= 0 && meetsGrowthRule(type, x, y)) {
+              int cell = static_cast<int>(region.index(x, y));
+              eligible[cell] = 1;
+              found.push_back(cell);
+           }
+        }
+      }
+   });
+
+   eligibleCells.clear();
+   for (int band = 0; band < bands; ++band) {
+      eligibleCells.insert(eligibleCells.end(), bandEligible[band].begin(), bandEligible[band].end());
+   }
+   frontierValid = true;
+}
+
+void CitySimulation::refreshFrontier() {
+   // Re-checking a changed cell's neighborhood costs 9 rule checks, so past
+   // a ninth of the region a rebuild is cheaper
+   long long area = 1ll * region.getWidth() * region.getHeight();
+   if (!frontierValid || static_cast<long long>(dirtyCells.size()) * 9 > area) {
+      rebuildFrontier();
+      return;
+   }
+
+   int stride = region.getStride();
+   const uint8_t* zones = region.zones();
+   addedCells.clear();
+   for (int cell : dirtyCells) {
+      dirtyMark[cell] = 0;
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+           int neighbor = cell + dy * stride + dx;
+           ZoneType type = static_cast<ZoneType>(zones[neighbor]);
+           if (growthPhase(type) < 0) continue;
+           uint8_t passes = meetsGrowthRule(type, neighbor % stride - RegionGrid::HALO,
+                                            neighbor / stride - RegionGrid::HALO);
+           if (passes == eligible[neighbor]) continue;
+           eligible[neighbor] = passes;
+           if (passes) addedCells.push_back(neighbor);
+        }
+      }
+   }
+   dirtyCells.clear();
+
+   // Drop the cells that stopped passing and merge in the new ones; each
+   // cell's outcome is fixed for the refresh, so none is added twice
+   eligibleCells.erase(remove_if(eligibleCells.begin(), eligibleCells.end(),
+                                 [this](int cell) { return !eligible[cell]; }),
+                       eligibleCells.end());
+   // Merged into a kept buffer; inplace_merge would allocate every call
+   sort(addedCells.begin(), addedCells.end());
+   mergedCells.resize(eligibleCells.size() + addedCells.size());
+   merge(eligibleCells.begin(), eligibleCells.end(), addedCells.begin(), addedCells.end(), mergedCells.begin());
+   eligibleCells.swap(mergedCells);
+}
+
+int CitySimulation::growthPhase(ZoneType zone) {
+   switch (zone) {
+      case ZoneType::COMMERCIAL: return 0;
+      case ZoneType::INDUSTRIAL: return 1;
+      case ZoneType::RESIDENTIAL: return 2;
+      default: return -1;
+   }
+}
+
+long long CitySimulation::candidateRank(const GrowthCandidate& candidate) const {
+   // Priority key, then row-major position: the order growth visits cells in
+   return static_cast<long long>(candidate.key) << 32 | region.index(candidate.x, candidate.y);
+}
+
+int CitySimulation::startKey(size_t cell) const {
+   // priorityKey as of the start of the step, from the committed populations
+   const uint8_t* committed = region.committedPopulations();
+   int stride = region.getStride();
+   int adjPop = 0;
+   for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        if (dx != 0 || dy != 0) adjPop += committed[cell + dy * stride + dx] >= 1;
+      }
+   }
+   return (MAX_POPULATION - committed[cell]) * (MAX_NEIGHBORS + 1) + (MAX_NEIGHBORS - adjPop);
+}
+
+void CitySimulation::wakeNeighbors(size_t cell, int phase) {
+   // A grower raised to p adds one to the "neighbors at or above p" count
+   // of exactly the neighbors at p, and nothing else changes their rules.
+   // Neighbors in this phase have had their turn already: at p they rank
+   // ahead of a grower that started the step below p. Unlisted neighbors of
+   // a later phase are queued for it.
+   if (fullScan) return;
+   const uint8_t* pops = region.populations();
+   const uint8_t* zones = region.zones();
+   int stride = region.getStride();
+   int raised = pops[cell];
+   for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        size_t neighbor = cell + static_cast<ptrdiff_t>(dy) * stride + dx;
+        if (listedStamp[neighbor] == growthStamp || pops[neighbor] != raised) continue;
+        int neighborPhase = growthPhase(static_cast<ZoneType>(zones[neighbor]));
+        if (neighborPhase <= phase) continue;
+        wokenLater[neighborPhase].push_back(static_cast<int>(neighbor));
+        listedStamp[neighbor] = growthStamp;
+      }
+   }
+}
+
+void CitySimulation::addWokenCells(vector<GrowthCandidate>& cells, int phase) {
+   // Merge the cells woken by earlier phases into this phase's order
+   vector<int>& woken = wokenLater[phase];
+   if (woken.empty()) return;
+
+   int stride = region.getStride();
+   sortScratch.clear();
+   for (int cell : woken) {
+      sortScratch.push_back({cell % stride - RegionGrid::HALO, cell / stride - RegionGrid::HALO, startKey(cell)});
+   }
+   auto byRank = [this](const GrowthCandidate& a, const GrowthCandidate& b) {
+      return candidateRank(a) < candidateRank(b);
+   };
+   sort(sortScratch.begin(), sortScratch.end(), byRank);
+   mergeScratch.resize(cells.size() + sortScratch.size());
+   merge(cells.begin(), cells.end(), sortScratch.begin(), sortScratch.end(), mergeScratch.begin(), byRank);
+   cells.swap(mergeScratch);
+   woken.clear();
+}
+
+void CitySimulation::growCells() {
+   if (growthMode != GrowthMode::VERIFY) {
+      {
+        SIMCITY_PROFILE_SCOPE(profiler, COLLECT);
+        collectFrontier();
+      }
+      {
+        SIMCITY_PROFILE_SCOPE(profiler, ORDER);
+        orderAllCandidates();
+      }
+      SIMCITY_PROFILE_SCOPE(profiler, GROW);
+      runGrowthPhases(growthMode == GrowthMode::PARALLEL);
+      return;
+   }
+
+   // Run the full scan serially on a copy, then the frontier in parallel
+   // for real, and insist they agree
+   RegionGrid before = region;
+   int workersBefore = availableWorkers;
+   int goodsBefore = availableGoods;
+   StateHash hashBefore = stateHash;
+   collectAll();
+   orderAllCandidates();
+   fullScan = true;
+   runGrowthPhases(false);
+   fullScan = false;
+   RegionGrid serialResult = region;
+   int serialWorkers = availableWorkers;
+   int serialGoods = availableGoods;
+
+   region = before;
+   availableWorkers = workersBefore;
+   availableGoods = goodsBefore;
+   stateHash = hashBefore;
+   collectFrontier();
+   orderAllCandidates();
+   runGrowthPhases(true);
+
+   if (!equal(region.populations(), region.populations() + region.size(), serialResult.populations()) ||
+      availableWorkers != serialWorkers || availableGoods != serialGoods) {
+      cerr << "Frontier growth diverged from a full scan at time step " << currentTimeStep << endl;
+      abort();
+   }
+}
+
+void CitySimulation::runGrowthPhases(bool parallel) {
+   // Commercial first, then industrial, then residential
+   growPhase<GrowthRules::Active::Commercial>(commercialCells, parallel);
+   growPhase<GrowthRules::Active::Industrial>(industrialCells, parallel);
+   growPhase<GrowthRules::Active::Residential>(residentialCells, parallel);
+}
+
+template <class Rules>
+void CitySimulation::growPhase(vector<GrowthCandidate>& cells, bool parallel) {
+   addWokenCells(cells, growthPhase(Rules::ZONE));
+   if (parallel) {
+      growParallel<Rules>(cells);
+   } else {
+      growSerial<Rules>(cells, 0);
+   }
+}
+
+bool CitySimulation::isNextToPower(int x, int y) const {
+   // Set by the power network: a conductor connected to a plant is in the
+   // cell's 3x3 neighborhood
+   return region.hasFlag(x, y, RegionGrid::POWERED);
+}
+
+void CitySimulation::setZoneType(int x, int y, ZoneType type) {
+   ZoneType oldType = region.getType(x, y);
+   if (oldType == type) return;
+   region.setType(x, y, type);
+
+   // Keep the derived state current without a rebuild
+   powerNetwork.tileChanged(region, x, y, oldType);
+#ifdef SIMCITY_CHECK_RESOURCES
+   checkPowerNetwork(x, y);
+#endif
+   if (oldType == ZoneType::INDUSTRIAL || type == ZoneType::INDUSTRIAL) {
+      pollutionEngine.sourceChanged(region, x, y);
+   }
+
+   // Power flags may have moved anywhere along the network
+   recorder.requestKeyframe();
+   frontierValid = false;
+
+   // States seen before the change no longer lead where they did
+   cycles.clear();
+}
+
+void CitySimulation::checkPowerNetwork(int x, int y) const {
+   // A full build on a copy must power exactly the cells the update did
+   RegionGrid rebuilt = region;
+   PowerNetwork().build(rebuilt);
+   for (int cy = 0; cy < region.getHeight(); ++cy) {
+      for (int cx = 0; cx < region.getWidth(); ++cx) {
+        if (region.hasFlag(cx, cy, RegionGrid::POWERED) != rebuilt.hasFlag(cx, cy, RegionGrid::POWERED)) {
+           cerr << "Power network drifted after the zone change at (" << x << ", " << y
+               << "): (" << cx << ", " << cy << ") is " << (region.hasFlag(cx, cy, RegionGrid::POWERED) ? "" : "not ")
+               << "powered" << endl;
+           abort();
+        }
+      }
+   }
+}
+
+bool CitySimulation::meetsGrowthRule(ZoneType zone, int x, int y) const {
+   switch (zone) {
+      case ZoneType::COMMERCIAL: return meetsRule<GrowthRules::Active::Commercial>(x, y);
+      case ZoneType::INDUSTRIAL: return meetsRule<GrowthRules::Active::Industrial>(x, y);
+      case ZoneType::RESIDENTIAL: return meetsRule<GrowthRules::Active::Residential>(x, y);
+      default: return false;
+   }
+}
+
+template <class Rules>
+bool CitySimulation::meetsRule(int x, int y) const {
+   // Cells past the last level never grow, and only population 0 looks
+   // at power
+   int pop = region.getPopulation(x, y);
+   if (pop >= Rules::LEVELS) return false;
+   bool powered = Rules::POWER_STARTS && pop == 0 && isNextToPower(x, y);
+   return GrowthRules::passes<Rules>(pop, getAdjacentPopulation(x, y, pop), powered);
+}
+
+template <class Rules>
+bool CitySimulation::canAfford() const {
+   return (Rules::WORKERS == 0 || availableWorkers >= Rules::WORKERS) &&
+          (Rules::GOODS == 0 || availableGoods >= Rules::GOODS);
+}
+
+template <class Rules>
+void CitySimulation::growSerial(const vector<GrowthCandidate>& cells, size_t first) {
+   const int phase = growthPhase(Rules::ZONE);
+   for (size_t i = first; i < cells.size(); ++i) {
+      int x = cells[i].x;
+      int y = cells[i].y;
+      if (!canAfford<Rules>()) continue;
+
+      SIMCITY_PROFILE_COUNT(profiler, RULE_CHECKS, 1);
+      SIMCITY_PROFILE_COUNT(profiler, NEIGHBOR_LOOKUPS, 1);
+      if (meetsRule<Rules>(x, y)) {
+        setPopulation(x, y, region.getPopulation(x, y) + 1);
+        availableWorkers -= Rules::WORKERS;
+        availableGoods -= Rules::GOODS;
+        SIMCITY_PROFILE_COUNT(profiler, CELLS_GROWN, 1);
+        wakeNeighbors(region.index(x, y), phase);
+      }
+   }
+}
+
+template <class Rules>
+void CitySimulation::growParallel(const vector<GrowthCandidate>& cells) {
+   // Every candidate is evaluated against the state at the start of the
+   // phase. Within a phase the rules read only a cell's own population, its
+   // power and its count of neighbors at or above that population, so a
+   // speculative answer can go stale only when an earlier grower rises to
+   // exactly that population next to it. Such conflicts are detected and
+   // everything from the first one on is replayed serially.
+   int count = static_cast<int>(cells.size());
+   if (count == 0) return;
+
+   int budget = INT_MAX;
+   if constexpr (Rules::WORKERS > 0) budget = min(budget, availableWorkers / Rules::WORKERS);
+   if constexpr (Rules::GOODS > 0) budget = min(budget, availableGoods / Rules::GOODS);
+
+   int bands = executor.bandCount(count);
+   bandGrowers.assign(bands, 0);
+   bandConflicts.assign(bands, count);
+   growthDecisions.resize(count);
+   if (candidateOrder.size() != region.size()) {
+      candidateOrder.assign(region.size(), -1);
+   }
+
+   // Speculative rule check, counting would-be growers per band
+   executor.forEachBand(count, [&](int band, int begin, int end) {
+      int growers = 0;
+      for (int i = begin; i < end; ++i) {
+        bool wants = meetsRule<Rules>(cells[i].x, cells[i].y);
+        growthDecisions[i] = wants;
+        growers += wants;
+        candidateOrder[region.index(cells[i].x, cells[i].y)] = i;
+      }
+      bandGrowers[band] = growers;
+   });
+   SIMCITY_PROFILE_COUNT(profiler, RULE_CHECKS, count);
+   SIMCITY_PROFILE_COUNT(profiler, NEIGHBOR_LOOKUPS, count);
+
+   // Exclusive prefix sum over the bands gives each grower its rank in
+   // priority order; only the first `budget` ranks fit the resources
+   int offset = 0;
+   for (int band = 0; band < bands; ++band) {
+      int growers = bandGrowers[band];
+      bandGrowers[band] = offset;
+      offset += growers;
+   }
+
+   const uint8_t* pops = region.populations();
+   executor.forEachBand(count, [&](int band, int begin, int end) {
+      int rank = bandGrowers[band];
+      for (int i = begin; i < end; ++i) {
+        if (!growthDecisions[i]) continue;
+        growthDecisions[i] = rank++ < budget;
+        if (!growthDecisions[i]) continue;
+
+        // Later candidates next to this grower whose threshold it crosses
+        size_t cell = region.index(cells[i].x, cells[i].y);
+        int raised = pops[cell] + 1;
+        for (int dy = -1; dy <= 1; ++dy) {
+           for (int dx = -1; dx <= 1; ++dx) {
+              size_t neighbor = cell + static_cast<ptrdiff_t>(dy) * region.getStride() + dx;
+              int order = candidateOrder[neighbor];
+              if (order > i && pops[neighbor] == raised) {
+                bandConflicts[band] = min(bandConflicts[band], order);
+              }
+           }
+        }
+      }
+   });
+   int firstConflict = *min_element(bandConflicts.begin(), bandConflicts.end());
+
+   executor.forEachBand(count, [&](int, int begin, int end) {
+      for (int i = begin; i < end; ++i) {
+        candidateOrder[region.index(cells[i].x, cells[i].y)] = -1;
+      }
+   });
+
+   // Commit the decisions that are known exact, then replay the rest
+   int grown = 0;
+   const int phase = growthPhase(Rules::ZONE);
+   for (int i = 0; i < firstConflict; ++i) {
+      if (growthDecisions[i]) {
+        setPopulation(cells[i].x, cells[i].y, region.getPopulation(cells[i].x, cells[i].y) + 1);
+        wakeNeighbors(region.index(cells[i].x, cells[i].y), phase);
+        grown++;
+      }
+   }
+   availableWorkers -= grown * Rules::WORKERS;
+   availableGoods -= grown * Rules::GOODS;
+   SIMCITY_PROFILE_COUNT(profiler, CELLS_GROWN, grown);
+   growSerial<Rules>(cells, firstConflict);
+}
+
 void CitySimulation::handleAlienInvasion() {
+    SIMCITY_PROFILE_SCOPE(profiler, INVASION);
+
     // Randomly select a cell to invade
-    int x = rand() % region[0].size();
-    int y = rand() % region.size();
-    Cell& cell = region[y][x];
+    int x = static_cast<int>(random.below(region.getWidth()));
+    int y = static_cast<int>(random.below(region.getHeight()));
 
     // Check if the cell is already invaded or if it's a power plant
-    if (cell.isAlienInvaded() || cell.getType() == ZoneType::POWER_PLANT) {
+    if (region.hasFlag(x, y, RegionGrid::ALIEN_INVADED) || region.getType(x, y) == ZoneType::POWER_PLANT) {
         return;
     }
 
     // Mark the cell as invaded
-    cell.setAlienInvaded(true);
-    std::cout << "Alien invasion occurred at (" << x << ", " << y << ")!" << std::endl;
+    region.setFlag(x, y, RegionGrid::ALIEN_INVADED, true);
+    if (recorder.isOpen()) {
+        recorder.cellChanged(x, y);
+    }
+    if (!quiet) {
+        output.text("Alien invasion occurred at (").number(x).text(", ").number(y).text(")!").newline();
+    }
 
     // Reduce the population of adjacent cells
     for (int dy = -1; dy <= 1; ++dy) {
@@ -346,125 +910,135 @@ void CitySimulation::handleAlienInvasion() {
             int newX = x + dx;
             int newY = y + dy;
             if (isValidCoordinate(newX, newY)) {
-                Cell& neighbor = region[newY][newX];
-                int reducedPopulation = std::max(0, neighbor.getPopulation() - 1); // Prevent negative population
-                if (neighbor.getPopulation() != reducedPopulation) {
-                    std::cout << "Population reduced at (" << newX << ", " << newY << ")" 
-                              << " from " << neighbor.getPopulation() 
-                              << " to " << reducedPopulation << std::endl;
+                int neighborPopulation = region.getPopulation(newX, newY);
+                int reducedPopulation = std::max(0, neighborPopulation - 1); // Prevent negative population
+                if (neighborPopulation != reducedPopulation && !quiet) {
+                    output.text("Population reduced at (").number(newX).text(", ").number(newY).text(")")
+                          .text(" from ").number(neighborPopulation)
+                          .text(" to ").number(reducedPopulation).newline();
                 }
-                neighbor.setPopulation(reducedPopulation);
+                setPopulation(newX, newY, reducedPopulation);
             }
         }
     }
 
-    // Recalculate resources post-invasion
+    // Recalculate resources post-invasion (O(1) from the running totals)
     calculateResources();
 
-    // Update pollution to reflect changes caused by the invasion
+    // Update pollution to reflect changes caused by the invasion; only the
+    // windows around industrial cells changed this step are re-diffused
     updatePollution();
 }
 
-  
-void CitySimulation::printFinalStats() {  
-   int totalResidential = 0;  
-   int totalIndustrial = 0;  
-   int totalCommercial = 0;  
-   int totalPollution = 0;  
-    
-   for (size_t y = 0; y < region.size(); ++y) {  
-      for (size_t x = 0; x < region[y].size(); ++x) {  
-        const Cell& cell = region[y][x];  
-        switch (cell.getType()) {  
-           case ZoneType::RESIDENTIAL:  
-              totalResidential += cell.getPopulation();  
-              break;  
-           case ZoneType::INDUSTRIAL:  
-              totalIndustrial += cell.getPopulation();  
-              break;  
-           case ZoneType::COMMERCIAL:  
-              totalCommercial += cell.getPopulation();  
-              break;  
-           default:  
-              break;  
-        }  
-  
-        // Add pollution contribution for each cell type  
-        if (cell.getType() == ZoneType::INDUSTRIAL) {  
-           totalPollution += pollution[y][x];  
-        }  
-      }  
-   }  
-  
-   // Output the final statistics  
-   cout << "Final Stats:" << endl;  
-   cout << "Total Residential Population: " << totalResidential << endl;  
-   cout << "Total Industrial Population: " << totalIndustrial << endl;  
-   cout << "Total Commercial Population: " << totalCommercial << endl;  
-   cout << "Total Pollution: " << totalPollution << endl;  
-    
-// Continuing from where we left off in CitySimulation::printFinalStats()  
-   std::cout << "\nPollution Map:" << std::endl;  
-   for (const auto& row : pollution) {  
-      for (size_t x = 0; x < row.size(); ++x) {  
-        std::cout << row[x];  
-        if (x < row.size() - 1) std::cout << ",";  
-      }  
-      std::cout << std::endl;  
-   }  
-}  
-  
-void CitySimulation::analyzeArea() {  
-   int x1, y1, x2, y2;  
-   do {  
-      std::cout << "\nEnter coordinates for area analysis (x1 y1 x2 y2): ";  
-      std::cin >> x1 >> y1 >> x2 >> y2;  
-       
-      // Ensure x1,y1 is top-left and x2,y2 is bottom-right  
-      if (x1 > x2) std::swap(x1, x2);  
-      if (y1 > y2) std::swap(y1, y2);  
-       
-      if (!isValidCoordinate(x1, y1) || !isValidCoordinate(x2, y2)) {  
-        std::cout << "Invalid coordinates. Please try again." << std::endl;  
-        std::cout << "Valid range is (0,0) to ("  
-               << region[0].size() - 1 << ","  
-               << region.size() - 1 << ")" << std::endl;  
-      }  
-   } while (!isValidCoordinate(x1, y1) || !isValidCoordinate(x2, y2));  
-  
-   int areaResidential = 0;  
-   int areaIndustrial = 0;  
-   int areaCommercial = 0;  
-   int areaPollution = 0;  
-   int areaAlienInvaded = 0;  
-  
-   for (int y = y1; y <= y2; ++y) {  
-      for (int x = x1; x <= x2; ++x) {  
-        const Cell& cell = region[y][x];  
-        switch (cell.getType()) {  
-           case ZoneType::RESIDENTIAL:  
-              areaResidential += cell.getPopulation();  
-              break;  
-           case ZoneType::INDUSTRIAL:  
-              areaIndustrial += cell.getPopulation();  
-              break;  
-           case ZoneType::COMMERCIAL:  
-              areaCommercial += cell.getPopulation();  
-              break;  
-           default:  
-              break;  
-        }  
-        areaPollution += pollution[y][x];  
-        if (cell.isAlienInvaded()) {  
-           areaAlienInvaded++;  
-        }  
-      }  
-   }  
-  
-   std::cout << "\nArea Analysis Results:" << std::endl;  
-   std::cout << "Residential Population: " << areaResidential << std::endl;  
-   std::cout << "Industrial Population: " << areaIndustrial << std::endl;  
-   std::cout << "Commercial Population: " << areaCommercial << std::endl;  
-   std::cout << "Total Pollution: " << areaPollution << std::endl;  
-   std::cout << "Alien Invaded Cells: " << areaAlienInvaded << std::endl;  
+
+CitySimulation::FinalStats CitySimulation::finalStats() const {
+   FinalStats stats;
+   for (int y = 0; y < region.getHeight(); ++y) {
+      for (int x = 0; x < region.getWidth(); ++x) {
+        ZoneType type = region.getType(x, y);
+        switch (type) {
+           case ZoneType::RESIDENTIAL:
+              stats.residential += region.getPopulation(x, y);
+              break;
+           case ZoneType::INDUSTRIAL:
+              stats.industrial += region.getPopulation(x, y);
+              break;
+           case ZoneType::COMMERCIAL:
+              stats.commercial += region.getPopulation(x, y);
+              break;
+           default:
+              break;
+        }
+
+        // Add pollution contribution for each cell type
+        if (type == ZoneType::INDUSTRIAL) {
+           stats.pollution += region.getPollution(x, y);
+        }
+        if (region.hasFlag(x, y, RegionGrid::ALIEN_INVADED)) {
+           stats.alienInvaded++;
+        }
+      }
+   }
+   stats.timeSteps = currentTimeStep;
+   stats.availableWorkers = availableWorkers;
+   stats.availableGoods = availableGoods;
+   return stats;
+}
+
+void CitySimulation::printFinalStats() {
+   FinalStats stats = finalStats();
+
+   // Output the final statistics
+   output.text("Final Stats:").newline();
+   output.text("Total Residential Population: ").number(stats.residential).newline();
+   output.text("Total Industrial Population: ").number(stats.industrial).newline();
+   output.text("Total Commercial Population: ").number(stats.commercial).newline();
+   output.text("Total Pollution: ").number(stats.pollution).newline();
+
+   output.text("\nPollution Map:").newline();
+   output.writePollution(region);
+   output.flush();
+}
+
+void CitySimulation::analyzeArea() {
+   int x1, y1, x2, y2;
+   do {
+      std::cout << "\nEnter coordinates for area analysis (x1 y1 x2 y2): ";
+      std::cin >> x1 >> y1 >> x2 >> y2;
+
+      // Ensure x1,y1 is top-left and x2,y2 is bottom-right
+      if (x1 > x2) std::swap(x1, x2);
+      if (y1 > y2) std::swap(y1, y2);
+
+      if (!isValidCoordinate(x1, y1) || !isValidCoordinate(x2, y2)) {
+        std::cout << "Invalid coordinates. Please try again." << std::endl;
+        std::cout << "Valid range is (0,0) to ("
+               << region.getWidth() - 1 << ","
+               << region.getHeight() - 1 << ")" << std::endl;
+      }
+   } while (!isValidCoordinate(x1, y1) || !isValidCoordinate(x2, y2));
+
+   areaTables.build(region);
+   AreaStats stats = areaTables.query(x1, y1, x2, y2);
+
+   std::cout << "\nArea Analysis Results:" << std::endl;
+   std::cout << "Residential Population: " << stats.residential << std::endl;
+   std::cout << "Industrial Population: " << stats.industrial << std::endl;
+   std::cout << "Commercial Population: " << stats.commercial << std::endl;
+   std::cout << "Total Pollution: " << stats.pollution << std::endl;
+   std::cout << "Alien Invaded Cells: " << stats.alienInvaded << std::endl;
+}
+
+bool CitySimulation::analyzeAreas(const string& queryFile) {
+   ifstream queries(queryFile);
+   if (!queries) return false;
+
+   // One CSV line per rectangle, in input order; rectangles outside the
+   // region are answered with "invalid" so lines stay aligned. A line that
+   // is not four integers (e.g. a truncated last record) fails the read.
+   areaTables.build(region);
+   output.text("x1,y1,x2,y2,residential,industrial,commercial,pollution,alien_invaded").newline();
+   string line;
+   while (getline(queries, line)) {
+      if (line.find_first_not_of(" \t\r") == string::npos) continue;
+      istringstream fields(line);
+      int x1, y1, x2, y2;
+      if (!(fields >> x1 >> y1 >> x2 >> y2) || !(fields >> ws).eof()) {
+        output.flush();
+        return false;
+      }
+      if (x1 > x2) std::swap(x1, x2);
+      if (y1 > y2) std::swap(y1, y2);
+      output.number(x1).text(",").number(y1).text(",").number(x2).text(",").number(y2).text(",");
+      if (!isValidCoordinate(x1, y1) || !isValidCoordinate(x2, y2)) {
+        output.text("invalid").newline();
+        continue;
+      }
+      AreaStats stats = areaTables.query(x1, y1, x2, y2);
+      output.number(stats.residential).text(",").number(stats.industrial).text(",")
+            .number(stats.commercial).text(",").number(stats.pollution).text(",")
+            .number(stats.alienInvaded).newline();
+   }
+   output.flush();
+   return true;
 }
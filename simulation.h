@@ -2,7 +2,20 @@
 #define SIMULATION_H
 #include <vector>
 #include <string>
+#include "areatables.h"
 #include "cell.h"
+#include "checkpoint.h"
+#include "executor.h"
+#include "grid.h"
+#include "loader.h"
+#include "output.h"
+#include "pollution.h"
+#include "power.h"
+#include "profiler.h"
+#include "random.h"
+#include "recorder.h"
+#include "regionfile.h"
+#include "statehash.h"
 
 class Alien {
 public:
@@ -18,19 +31,192 @@ private:
 
 class CitySimulation {
 public:
-    bool loadConfiguration(const std::string& filename);
+    // How growCells commits growth. Both SERIAL and PARALLEL evaluate only
+    // the active frontier; VERIFY also runs the original full scan of every
+    // cell serially each step and aborts if the grids differ.
+    enum class GrowthMode {
+        SERIAL,
+        PARALLEL,
+        VERIFY
+    };
+
+    // threads sizes the worker pool from the start (0 = hardware
+    // concurrency), so a caller that wants one thread never starts more
+    explicit CitySimulation(int threads = 0);
+
+    // The configuration file holds the region file, the step count, the
+    // refresh rate and optionally a checkpoint interval and path. With
+    // resume set, an existing checkpoint is loaded instead of the region.
+    bool loadConfiguration(const std::string& filename, bool resume = false);
+
+    // loadConfiguration in two halves, so settings can be overridden in
+    // between: read the settings, then load the region (or checkpoint)
+    bool readConfiguration(const std::string& filename);
+    bool load(bool resume = false);
+
+    void setRegionFile(const std::string& filename);
+    void setMaxTimeSteps(int steps);
+    void setRefreshRate(int rate);  // 0 prints only the initial map
+    void setCheckpoint(int interval, const std::string& filename);
+    void setSeed(uint64_t seed);
+
+    // The populations after every step are hashed, and a state repeating
+    // one of the last CycleDetector::HISTORY steps is reported once as a
+    // cycle. With stop set the run also ends there. Invasions draw fresh
+    // random numbers each pass, so a repeat means the city came back to an
+    // earlier state; it is not proof that it will keep cycling.
+    void setStopOnCycle(bool on);
+    int getCyclePeriod() const { return cyclePeriod; }  // 0 if no repeat was seen
+
+    const std::string& getRegionFile() const { return regionFile; }
+    int getMaxTimeSteps() const { return maxTimeSteps; }
+    int getTimeStep() const { return currentTimeStep; }
+
+    // Suppress region maps, reports and invasion messages
+    void setQuiet(bool on);
+
+    // Load or save the region. Paths ending in .simregion use the binary
+    // format, which also keeps population, pollution, flags, the time step
+    // and resources; anything else is a CSV zone layout.
+    bool loadRegion(const std::string& filename);
+    bool saveRegion(const std::string& filename) const;
+
+    // Start from a copy of an already loaded layout, sharing its zone plane
+    bool loadRegion(const RegionGrid& layout);
+    // Totals over the region as printFinalStats reports them
+    struct FinalStats {
+        long long residential = 0;
+        long long industrial = 0;
+        long long commercial = 0;
+        long long pollution = 0;  // Over industrial cells
+        long long alienInvaded = 0;
+        int timeSteps = 0;
+        int availableWorkers = 0;
+        int availableGoods = 0;
+    };
+
     void runSimulation();
+    FinalStats finalStats() const;
     void printFinalStats();
     void analyzeArea();
 
+    // Answer the "x1 y1 x2 y2" rectangle on each line of queryFile, one CSV
+    // line each, on the region output; false if the file cannot be read or
+    // a non-blank line is not exactly four integers
+    bool analyzeAreas(const std::string& queryFile);
+
+    // Worker threads for the tiled phases; 0 picks the hardware concurrency
+    void setThreadCount(int threads);
+    void setGrowthMode(GrowthMode mode);
+
+    // Send region maps and reports to a file instead of stdout, and choose
+    // whether maps are written in full or as changes since the last one
+    bool setOutputFile(const std::string& filename);
+    void setOutputMode(RegionWriter::Mode mode);
+
+    // Append every following step's changes to a .simdelta history, with a
+    // full keyframe every keyframeInterval steps; call after loading
+    bool recordHistory(const std::string& filename,
+                       int keyframeInterval = StepRecorder::DEFAULT_KEYFRAME_INTERVAL);
+
+    // Write a Chrome trace of every phase of the next run to filename;
+    // false unless the program was built with -DSIMCITY_PROFILE
+    bool setTraceFile(const std::string& filename);
+
+    // Change one tile after loading; power and pollution follow incrementally
+    void setZoneType(int x, int y, ZoneType type);
+
 private:
-    std::vector<std::vector<Cell>> region;
-    std::vector<std::vector<int>> pollution;
-    int maxTimeSteps;
-    int refreshRate;
-    int currentTimeStep;
+    friend class SimulationBenchmark;  // bench.cpp times the private phases
+
+    // A cell queued for growth with its precomputed priority key
+    struct GrowthCandidate {
+        int x;
+        int y;
+        int key;
+    };
+
+    // Candidates found in one row band
+    struct CandidateLists {
+        std::vector<GrowthCandidate> commercial;
+        std::vector<GrowthCandidate> industrial;
+        std::vector<GrowthCandidate> residential;
+    };
+
+    RegionGrid region;  // Zone types, population, pollution and flags
+    PollutionEngine pollutionEngine;
+    PowerNetwork powerNetwork;
+    ParallelExecutor executor;
+    GrowthMode growthMode = GrowthMode::PARALLEL;
+    std::string regionFile;
+    int maxTimeSteps = 0;
+    int refreshRate = 0;
+    int currentTimeStep = 0;
     int availableWorkers;
     int availableGoods;
+    int lastStepChanges;  // Cells whose population changed in the last step
+
+    // Checkpointing; an interval of 0 disables it
+    int checkpointInterval = 0;
+    std::string checkpointPath;
+    CheckpointWriter checkpointWriter;
+    RegionWriter output;
+    bool quiet = false;
+    StepRecorder recorder;
+    AreaTables areaTables;
+
+    Random random;  // Invasion randomness, saved with checkpoints
+
+    // Cycle detection over the hashed step states
+    StateHash stateHash;
+    CycleDetector cycles;
+    bool stopOnCycle = false;
+    int cyclePeriod = 0;
+
+    // Phase timings, only collected in SIMCITY_PROFILE builds
+    Profiler profiler;
+    std::string traceFile;
+
+    // Growth ordering buffers, kept across steps to avoid reallocating
+    static const int MAX_POPULATION = 255;
+    static const int MAX_NEIGHBORS = 8;
+    static const int PRIORITY_KEYS = (MAX_POPULATION + 1) * (MAX_NEIGHBORS + 1);
+    std::vector<GrowthCandidate> commercialCells;
+    std::vector<GrowthCandidate> industrialCells;
+    std::vector<GrowthCandidate> residentialCells;
+    std::vector<GrowthCandidate> sortScratch;
+    std::vector<GrowthCandidate> mergeScratch;
+    std::vector<int> bucketCounts;
+    std::vector<CandidateLists> bandCandidates;
+    std::vector<std::pair<int, int>> bandTotals;  // Workers and goods per band
+
+    // Active frontier. Growth rules read only a cell's own population, its
+    // neighbors' populations and its power, so a cell can start or stop
+    // passing its rule only when a population in its 3x3 neighborhood
+    // changed. The cells passing on the committed state are kept in
+    // row-major order and refreshed around the cells changed since; during a
+    // step, growth that lifts a neighbor to a cell's population wakes that
+    // cell for its zone's phase if the phase is still to come.
+    std::vector<uint8_t> eligible;         // Per cell: passes its growth rule
+    std::vector<int> eligibleCells;        // The passing cells, ascending
+    std::vector<int> addedCells;           // Refresh scratch
+    std::vector<int> mergedCells;
+    std::vector<std::vector<int>> bandEligible;
+    std::vector<int> dirtyCells;           // Population changed since the last refresh
+    std::vector<uint8_t> dirtyMark;
+    bool frontierValid = false;
+    bool fullScan = false;                 // VERIFY's reference pass: nothing is woken
+
+    // Cells listed or woken this step carry the step's stamp
+    std::vector<unsigned> listedStamp;
+    unsigned growthStamp = 0;
+    std::vector<int> wokenLater[3];        // Woken for a later phase, by phase
+
+    // Parallel growth scratch
+    std::vector<uint8_t> growthDecisions;
+    std::vector<int> candidateOrder;  // Per cell: index in the current phase, or -1
+    std::vector<int> bandGrowers;
+    std::vector<int> bandConflicts;
 
     void spawnAlien();
     void moveAlien();
@@ -38,12 +224,42 @@ private:
     void handleAlienInvasion();  // Added missing declaration
 
     bool loadRegionLayout(const std::string& filename);
+    void startFromLayout();
+    RegionState captureState() const;
     void printRegionState();
     void simulateTimeStep();
     void updatePollution();
-    bool hasChanged(const std::vector<std::vector<Cell>>& previousState);
+    void setPopulation(int x, int y, int pop);
+    bool hasChanged() const;
     void calculateResources();
+    void recountResources(int& workers, int& goods);
+    void checkPowerNetwork(int x, int y) const;
     void growCells();
+    void collectAll();
+    void collectFrontier();
+    void refreshFrontier();
+    void rebuildFrontier();
+    void collectCandidates(CandidateLists& lists, int beginRow, int endRow) const;
+    void collectEligible(CandidateLists& lists, int begin, int end);
+    void mergeCandidates(int bands);
+    void orderAllCandidates();
+    void runGrowthPhases(bool parallel);
+    void addWokenCells(std::vector<GrowthCandidate>& cells, int phase);
+    void wakeNeighbors(std::size_t cell, int phase);
+    int startKey(std::size_t cell) const;
+    long long candidateRank(const GrowthCandidate& candidate) const;
+    static int growthPhase(ZoneType zone);
+
+    // Growth kernels, one instance per zone's GrowthRules policy
+    template <class Rules> void growPhase(std::vector<GrowthCandidate>& cells, bool parallel);
+    template <class Rules> void growSerial(const std::vector<GrowthCandidate>& cells, size_t first);
+    template <class Rules> void growParallel(const std::vector<GrowthCandidate>& cells);
+    template <class Rules> bool meetsRule(int x, int y) const;
+    template <class Rules> bool canAfford() const;
+    bool meetsGrowthRule(ZoneType zone, int x, int y) const;  // Dispatches on the zone
+    bool isNextToPower(int x, int y) const;
+    int priorityKey(int x, int y) const;
+    void orderCandidates(std::vector<GrowthCandidate>& cells);
     bool isValidCoordinate(int x, int y) const;
     int getAdjacentPopulation(int x, int y, int minPop) const;
 
@@ -0,0 +1,31 @@
+#include "statehash.h"
+
+void StateHash::reset(const RegionGrid& grid) {
+    value = 0;
+    const uint8_t* pops = grid.populations();
+    for (int y = 0; y < grid.getHeight(); ++y) {
+        for (std::size_t cell = grid.index(0, y), end = grid.index(grid.getWidth(), y); cell < end; ++cell) {
+            value ^= populationKey(cell, pops[cell]);
+        }
+    }
+}
+
+void CycleDetector::clear() {
+    count = 0;
+    next = 0;
+}
+
+int CycleDetector::record(uint64_t hash, int step) {
+    // Newest first, so the shortest period is reported
+    int period = 0;
+    for (int i = 1; i <= count && period == 0; ++i) {
+        int slot = (next - i + HISTORY) % HISTORY;
+        if (hashes[slot] == hash) period = step - steps[slot];
+    }
+
+    hashes[next] = hash;
+    steps[next] = step;
+    next = (next + 1) % HISTORY;
+    if (count < HISTORY) count++;
+    return period;
+}
@@ -0,0 +1,65 @@
+#ifndef STATEHASH_H
+#define STATEHASH_H
+#include <cstddef>
+#include <cstdint>
+#include "grid.h"
+
+// Zobrist-style 64-bit hash of a region's populations: every populated
+// cell contributes a key for its (cell, population) pair, all XORed
+// together, so a population change is two key lookups. Zones and power are
+// fixed while a run lasts and pollution and resources follow from the
+// populations, so equal hashes mean equal states up to a collision chance
+// of about 2^-64 per pair. Invasion marks are left out: they only record
+// where invasions landed, and since they never clear, no state could repeat
+// until every cell had been hit. Keys are computed from the cell and value
+// rather than stored, so the hash needs no per-cell table.
+class StateHash {
+public:
+    // Hash the whole grid from scratch
+    void reset(const RegionGrid& grid);
+
+    void populationChanged(std::size_t cell, int oldPop, int newPop) {
+        value ^= populationKey(cell, oldPop) ^ populationKey(cell, newPop);
+    }
+
+    uint64_t getValue() const { return value; }
+
+private:
+    static const uint64_t POPULATION_SALT = 0x5851F42D4C957F2Dull;
+
+    uint64_t value = 0;
+
+    // Empty cells contribute nothing, so a new grid hashes to 0
+    static uint64_t populationKey(std::size_t cell, int pop) {
+        return pop == 0 ? 0 : mix(POPULATION_SALT + cell * 256 + static_cast<uint64_t>(pop));
+    }
+
+    // SplitMix64 finalizer
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+// Remembers the state hashes of the last HISTORY steps in a ring, so a run
+// that has settled into a cycle of up to HISTORY steps is noticed the first
+// time a state comes round again.
+class CycleDetector {
+public:
+    static const int HISTORY = 256;
+
+    void clear();
+
+    // Record the state after the given step; returns the cycle period if
+    // the same state was seen within the window, 0 otherwise
+    int record(uint64_t hash, int step);
+
+private:
+    uint64_t hashes[HISTORY];
+    int steps[HISTORY];
+    int count = 0;
+    int next = 0;
+};
+
+#endif